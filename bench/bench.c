@@ -0,0 +1,253 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+/* timings for the parse, scan and render paths over a tree generated
+ * by gentree.sh. results go to stdout as one json object per benchmark */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+
+#include "animenu.h"
+#include "menu.h"
+#include "osd.h"
+#include "options.h"
+
+#define _freecfg(A) free((void*)A[0]),free((void*)A)
+
+/* osd windows are as tall as their item list, and X caps window sizes.
+ * offscreen, they'd take as much memory */
+#define BENCH_MAXOSDITEMS 1000
+#define BENCH_KEYPRESSES 100
+
+struct benchresult {
+  const char *name;
+  int runs;
+  double total, min, max;
+};
+
+static int items;
+static const char *tree;
+static const char *backend = "x11";
+
+static double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec * 1e6 + ts.tv_nsec / 1e3);
+}
+
+static void bench_start(struct benchresult *result, const char *name) {
+  memset(result, 0, sizeof(struct benchresult));
+  result->name = name;
+}
+
+static void bench_sample(struct benchresult *result, double usecs) {
+  if (result->runs == 0 || usecs < result->min)
+    result->min = usecs;
+  if (usecs > result->max)
+    result->max = usecs;
+  result->total += usecs;
+  ++result->runs;
+}
+
+static void bench_report(struct benchresult *result) {
+  printf("{\"bench\": \"%s\", \"version\": \"%s\", \"backend\": \"%s\", \"items\": %d, "
+         "\"runs\": %d, \"mean_us\": %.1f, \"min_us\": %.1f, \"max_us\": %.1f}\n",
+         result->name, VERSION, backend, items, result->runs,
+         result->runs ? result->total / result->runs : 0.0, result->min, result->max);
+  fflush(stdout);
+}
+
+/* smaller trees get more runs, so each size takes a similar time */
+static int bench_runs() {
+  int runs = 100000 / (items > 0 ? items : 1);
+  return(runs < 3 ? 3 : (runs > 50 ? 50 : runs));
+}
+
+static void bench_parse(const char *rootfile) {
+  struct benchresult result;
+  char **itemcfg;
+  double start;
+  FILE *f;
+  int run, runs = bench_runs();
+
+  bench_start(&result, "parse");
+  for (run = 0; run < runs; ++run) {
+    if (!(f = fopen(rootfile, "r"))) {
+      fprintf(stderr, "cannot open '%s'\n", rootfile);
+      exit(EXIT_FAILURE);
+    }
+    start = bench_now();
+    while (animenu_readmenufile(f, &itemcfg))
+      _freecfg(itemcfg);
+    bench_sample(&result, bench_now() - start);
+    fclose(f);
+  }
+  bench_report(&result);
+}
+
+/* the tree built as at startup, but without osds, so needs no display */
+static void bench_build(const char *rootfile) {
+  struct benchresult result;
+  struct animenucontext *menu;
+  double start;
+  int run, runs = bench_runs();
+
+  bench_start(&result, "build");
+  for (run = 0; run < runs; ++run) {
+    start = bench_now();
+    if (!(menu = animenu_buildtree(rootfile))) {
+      fprintf(stderr, "cannot create menu from '%s'\n", rootfile);
+      exit(EXIT_FAILURE);
+    }
+    bench_sample(&result, bench_now() - start);
+    menu->dispose(menu);
+  }
+  bench_report(&result);
+}
+
+static void bench_tree(const char *rootfile) {
+  struct benchresult result;
+  struct animenucontext *menu;
+  double start;
+  int run, runs = bench_runs();
+
+  bench_start(&result, "tree");
+  for (run = 0; run < runs; ++run) {
+    start = bench_now();
+    if (!(menu = animenu_buildtree(rootfile))) {
+      fprintf(stderr, "cannot create menu from '%s'\n", rootfile);
+      exit(EXIT_FAILURE);
+    }
+    animenu_genosd(menu);
+    osd_wait();
+    bench_sample(&result, bench_now() - start);
+    menu->dispose(menu);
+  }
+  bench_report(&result);
+}
+
+static struct animenucontext *bench_scanonce(char *regex) {
+  struct animenucontext *menu;
+  if (!(menu = animenu_createfilesystem(NULL, regex, NULL, "true", 0))) {
+    fprintf(stderr, "cannot scan '%s'\n", regex);
+    exit(EXIT_FAILURE);
+  }
+  return(menu);
+}
+
+static void bench_scan(char *regex) {
+  struct benchresult result;
+  struct animenucontext *menu;
+  double start;
+  int run, runs = bench_runs();
+
+  bench_start(&result, "scan");
+  for (run = 0; run < runs; ++run) {
+    start = bench_now();
+    menu = bench_scanonce(regex);
+    bench_sample(&result, bench_now() - start);
+    menu->dispose(menu);
+  }
+  bench_report(&result);
+}
+
+static void bench_render(char *regex) {
+  struct benchresult create, showframe, hideframe, keypress;
+  struct animenucontext *menu;
+  double start;
+  int run, runs = bench_runs(), frame;
+
+  bench_start(&create, "osd_create");
+  bench_start(&showframe, "showframe");
+  bench_start(&hideframe, "hideframe");
+  bench_start(&keypress, "keypress");
+  for (run = 0; run < runs; ++run) {
+    menu = bench_scanonce(regex);
+    start = bench_now();
+    animenu_genosd(menu);
+    osd_wait();
+    bench_sample(&create, bench_now() - start);
+
+    for (frame = 0; frame < OSD_MAXANIMFRAME; frame += 30) {
+      start = bench_now();
+      menu->osd->showframe(menu->osd, frame);
+      osd_wait();
+      bench_sample(&showframe, bench_now() - start);
+    }
+    menu->visible = TRUE;
+
+    /* a single 'next' through to the pixels reaching the server */
+    for (frame = 0; frame < BENCH_KEYPRESSES; ++frame) {
+      start = bench_now();
+      menu->move(menu, 1);
+      osd_wait();
+      bench_sample(&keypress, bench_now() - start);
+    }
+
+    for (frame = 0; frame < OSD_MAXANIMFRAME; frame += 40) {
+      start = bench_now();
+      menu->osd->hideframe(menu->osd, frame);
+      osd_wait();
+      bench_sample(&hideframe, bench_now() - start);
+    }
+    menu->visible = FALSE;
+    menu->dispose(menu);
+  }
+  bench_report(&create);
+  bench_report(&showframe);
+  bench_report(&keypress);
+  bench_report(&hideframe);
+}
+
+static int bench_canrender(const char *name, int rows) {
+  if (rows > BENCH_MAXOSDITEMS) {
+    fprintf(stderr, "%d items won't fit an osd window, skipping %s benchmarks\n", rows, name);
+    return(FALSE);
+  }
+  return(TRUE);
+}
+
+int main(int argc, char *argv[]) {
+  char home[PATH_MAX], rootfile[PATH_MAX], regex[PATH_MAX];
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s TREE ITEMS\n", argv[0]);
+    return(EXIT_FAILURE);
+  }
+  tree = argv[1];
+  items = atoi(argv[2]);
+
+  /* menu files are resolved relative to $HOME/.animenu */
+  snprintf(home, PATH_MAX, "%s/home", tree);
+  setenv("HOME", home, 1);
+  process_options(1, argv);
+  snprintf(rootfile, PATH_MAX, "%s/.animenu/root.menu", home);
+  snprintf(regex, PATH_MAX, "%s/media/.*\\.(mp3|wav|flac)", tree);
+  /* without a display the osds are drawn offscreen */
+  if (!getenv("DISPLAY")) {
+    osd_setbackend(osd_memory);
+    backend = "memory";
+  }
+
+  bench_parse(rootfile);
+  bench_scan(regex);
+  bench_build(rootfile);
+  /* the tree is built as at startup, osds and all. the root menu is
+   * the largest, the browse item and three sub-menus besides the items */
+  if (bench_canrender("tree", items + 4))
+    bench_tree(rootfile);
+  if (bench_canrender("render", items))
+    bench_render(regex);
+
+  return(EXIT_SUCCESS);
+}
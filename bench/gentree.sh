@@ -0,0 +1,63 @@
+#!/bin/sh
+##
+# animenu - lirc menu system
+#
+#  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+#  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+#
+#  licensed under GNU General Public License 2.0 or later
+#  some rights reserved. see COPYING, AUTHORS
+#
+
+##
+# generate a synthetic menu tree and media directory for benchmarking
+#
+# gentree.sh DIR ITEMS
+#
+# DIR/home/.animenu/root.menu  : 'browse' item for DIR/media, three
+#                                sub-menus of ITEMS/10 items each, and
+#                                ITEMS command items
+# DIR/media                    : ITEMS matching files, ITEMS/10 files which
+#                                don't match the browse pattern, and
+#                                ITEMS/100 sub-directories
+
+[ $# -eq 2 ] || { echo "usage: $0 DIR ITEMS" >&2; exit 1; }
+dir="$1"
+items="$2"
+menus="$dir/home/.animenu"
+media="$dir/media"
+
+mkdir -p "$menus" "$media" || exit 1
+
+awk -v items="$items" -v media="$media" 'BEGIN {
+  printf "browse %s/.*\\.(mp3|wav|flac)\n  media\n  true\n", media
+  for (m = 1; m <= 3; m++)
+    printf "menu\n  sub menu %d\n  sub%d.menu\n", m, m
+  for (i = 0; i < items; i++)
+    printf "item\n  entry %06d\n  true %d\n", i, i
+}' > "$menus/root.menu"
+
+for m in 1 2 3; do
+  awk -v items="$items" -v m="$m" 'BEGIN {
+    # a comment, as found in hand written menus
+    print "# generated sub menu " m
+    for (i = 0; i < items / 10; i++)
+      printf "item\n  sub %d entry %06d\n  true %d\n", m, i, i
+  }' > "$menus/sub$m.menu"
+done
+
+(
+  cd "$media" || exit 1
+  awk -v items="$items" 'BEGIN {
+    ext[0] = "mp3"; ext[1] = "wav"; ext[2] = "flac"
+    for (i = 0; i < items; i++)
+      printf "track %06d.%s\n", i, ext[i % 3]
+    for (i = 0; i < items / 10; i++)
+      printf "cover %06d.jpg\n", i
+  }' | tr '\n' '\0' | xargs -0 touch
+  i=0
+  while [ $i -lt $((items / 100)) ]; do
+    mkdir "album $i"
+    i=$((i + 1))
+  done
+)
@@ -0,0 +1,53 @@
+#!/bin/sh
+##
+# animenu - lirc menu system
+#
+#  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+#  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+#
+#  licensed under GNU General Public License 2.0 or later
+#  some rights reserved. see COPYING, AUTHORS
+#
+
+##
+# run the benchmarks over a range of tree sizes
+#
+# run.sh BENCH OUTPUT SIZE..
+#
+# results are written to OUTPUT as one json object per line. the render
+# benchmarks run against a private Xvfb server when one is available,
+# otherwise against $DISPLAY, and are drawn offscreen without either
+
+[ $# -ge 3 ] || { echo "usage: $0 BENCH OUTPUT SIZE.." >&2; exit 1; }
+bench="$1"
+output="$2"
+shift 2
+srcdir=$(dirname "$0")
+data=$(mktemp -d "${TMPDIR:-/tmp}/animenu-bench.XXXXXX") || exit 1
+xvfb=""
+
+cleanup() {
+  [ -n "$xvfb" ] && kill "$xvfb" 2>/dev/null
+  rm -rf "$data"
+}
+trap cleanup EXIT INT TERM
+
+if command -v Xvfb >/dev/null 2>&1; then
+  display=:$(( ($$ % 500) + 100 ))
+  Xvfb $display -screen 0 1920x1080x24 -nolisten tcp >/dev/null 2>&1 &
+  xvfb=$!
+  sleep 1
+  DISPLAY=$display
+  export DISPLAY
+elif [ -z "$DISPLAY" ]; then
+  echo "no Xvfb or DISPLAY, render benchmarks will be skipped" >&2
+fi
+
+: > "$output"
+for items in "$@"; do
+  echo "benchmarking $items items" >&2
+  rm -rf "$data/tree"
+  sh "$srcdir/gentree.sh" "$data/tree" "$items" || exit 1
+  "$bench" "$data/tree" "$items" >> "$output" || exit 1
+done
+echo "results written to '$output'" >&2
@@ -15,14 +15,15 @@
 
 #include <errno.h>
 #include <unistd.h>
-#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 #include <time.h>
 #include <lirc/lirc_client.h>
 
@@ -30,15 +31,21 @@
 #include "osd.h"
 #include "menu.h"
 #include "options.h"
+#include "loop.h"
+#include "control.h"
+#include "prewarm.h"
+#include "trace.h"
 
 
-enum command_ids {id_null, id_show, id_next, id_prev, id_select, id_back, id_forward};
+enum command_ids {id_null, id_show, id_next, id_prev, id_select, id_back, id_forward,
+                  id_pageup, id_pagedown, id_home, id_end, id_jump, id_t9};
 
 struct lirc_command {
   int id;
   const char *name;
   int args, argsread;
   int value1, value2, value3;
+  char text[32];
 };
 struct lirc_command lirc_commands[] = {
   {id_show, "show", 0, 0, 0, 0, 0},
@@ -47,20 +54,39 @@ struct lirc_command lirc_commands[] = {
   {id_select, "select", 0, 0, 0, 0, 0},
   {id_back, "back", 0, 0, 0, 0, 0},
   {id_forward, "forward", 0, 0, 0, 0, 0},
+  {id_pageup, "pageup", 0, 0, 0, 0, 0},
+  {id_pagedown, "pagedown", 0, 0, 0, 0, 0},
+  {id_home, "home", 0, 0, 0, 0, 0},
+  {id_end, "end", 0, 0, 0, 0, 0},
+  {id_jump, "jump", 0, 0, 0, 0, 0},
+  {id_t9, "t9", 0, 0, 0, 0, 0},
   {0, NULL, 0, 0, 0, 0, 0}
 };
 
 /* globals */
 static struct animenucontext *rootmenu;
 static struct animenucontext *currentmenu;
-static int alarm_pending;
+static struct loopcontext *loop;
+static struct controlcontext *control = NULL;
+static struct lirc_config *lircconfig = NULL;
+static char rootfile[PATH_MAX] = "";
+static int notifyfd = -1;
+static int lircrcwatch = -1, menuwatch = -1;
+static char menudir[PATH_MAX] = "";
+static const char *lircrcname;
+static struct looptimer *menutimer;
+static int pendingmoves = 0;
+static char typeahead[64] = "";
+static int typeaheadt9 = FALSE;
+static struct looptimer *typeaheadtimer;
+static struct looptimer *dwelltimer;
+static struct prewarmcontext *prewarm = NULL;
+static struct looptimer *prewarmtimer;
 
-void sigalarm_handler(int junk) {
-  if (alarm_pending) {
-    alarm_pending = 0;
-    rootmenu->hide(rootmenu);
-  }
-}
+#define TYPEAHEAD_TIMEOUT 1500
+/* msecs the selection must rest on an item before its sub menu is
+ * got ready, so scrolling past doesn't start anything */
+#define DWELL_TIMEOUT 300
 
 struct lirc_command * parse_codes(struct lirc_command* cmds, const char *cmd) {
   struct lirc_command *c = NULL;
@@ -77,6 +103,8 @@ struct lirc_command * parse_codes(struct lirc_command* cmds, const char *cmd) {
         c = &cmds[i];
         c->value1 = c->value2 = c->value3 = 0;
         c->argsread = sscanf(cmd, "%*s %d %d %d", &c->value1, &c->value2, &c->value3);
+        c->text[0] = '\0';
+        sscanf(cmd, "%*s %31s", c->text);
         return (c);
       }
       ++i;
@@ -87,9 +115,449 @@ struct lirc_command * parse_codes(struct lirc_command* cmds, const char *cmd) {
   return(NULL);
 }
 
+/* menu timeout, run from the main loop so it can never interrupt a draw */
+static void animenu_timeout(void *ud) {
+  if (rootmenu->visible) {
+    rootmenu->hide(rootmenu);
+    currentmenu = NULL;
+  }
+}
+
+/* move the timeout on, or drop it once the menu is hidden. the dwell
+ * on the selection starts over along with it */
+static void animenu_resettimeout() {
+  struct animenu_options* options = get_options();
+  if (options->menutimeout != 0)
+    loop->settimer(loop, menutimer, rootmenu->visible ? options->menutimeout : 0);
+  loop->settimer(loop, dwelltimer, rootmenu->visible ? DWELL_TIMEOUT : 0);
+}
+
+static void animenu_dwell(void *ud) {
+  if (rootmenu->visible && currentmenu && currentmenu->currentitem)
+    animenu_speculate(currentmenu->currentitem);
+}
+
+/* apply the net result of any queued next/prev commands */
+static void animenu_flushmoves() {
+  if (pendingmoves != 0) {
+    _tracestart(tracestart);
+    if (currentmenu != NULL)
+      currentmenu->move(currentmenu, pendingmoves);
+    _traceend(tracestart, "move", NULL);
+    pendingmoves = 0;
+    animenu_resettimeout();
+  }
+}
+
+/* walk the browse directories while the menus are hidden, and again
+ * every 'prewarm' after. any command puts it off for as long again */
+static void animenu_prewarmtick(void *ud) {
+  struct animenu_options* options = get_options();
+  char **paths;
+  int count;
+
+  if (!rootmenu->visible) {
+    count = animenu_browsebases(rootmenu, &paths);
+    prewarm->start(prewarm, paths, count);
+  }
+  loop->settimer(loop, prewarmtimer, options->prewarm);
+}
+
+static void animenu_prewarmdone(void *ud) {
+  if (!rootmenu->visible)
+    animenu_revalidate(rootmenu);
+}
+
+static void animenu_prewarmstop() {
+  struct animenu_options* options = get_options();
+  if (prewarm) {
+    prewarm->stop(prewarm);
+    loop->settimer(loop, prewarmtimer, options->prewarm);
+  }
+}
+
+static void animenu_typeaheadreset(void *ud) {
+  typeahead[0] = '\0';
+}
+
+/* extend the typed prefix and jump to the first match. when nothing
+ * matches the typing starts over from the latest keypress */
+static void animenu_typeahead(const char *text, int t9) {
+  if (currentmenu == NULL || !*text)
+    return;
+  if (t9 != typeaheadt9)
+    typeahead[0] = '\0';
+  typeaheadt9 = t9;
+  if (strlen(typeahead) + strlen(text) >= sizeof(typeahead))
+    typeahead[0] = '\0';
+  strcat(typeahead, text);
+  if (!currentmenu->jump(currentmenu, typeahead, t9)) {
+    _strncpy(typeahead, text, sizeof(typeahead));
+    if (!currentmenu->jump(currentmenu, typeahead, t9))
+      typeahead[0] = '\0';
+  }
+  loop->settimer(loop, typeaheadtimer, TYPEAHEAD_TIMEOUT);
+}
+
+/* net move for a jump of 'step' items from wherever the queued moves
+ * leave the selection. unlike single steps, jumps stop at the first or
+ * last item rather than cycling round */
+static int animenu_jumpdelta(int step) {
+  int count, pos, target;
+  if ((count = currentmenu->itemcount) == 0)
+    return(0);
+  pos = currentmenu->currentitem ? currentmenu->currentitem->index : count;
+  pos = ((pos + pendingmoves) % (count + 1) + count + 1) % (count + 1);
+  if (pos == count)
+    pos = step > 0 ? -1 : count;
+  target = pos + step;
+  if (target < 0)
+    target = 0;
+  else if (target >= count)
+    target = count - 1;
+  return(target - pos);
+}
+
+/* step size for a held button. one item at a time, then a page at a
+ * time, then a tenth of the menu at a time as the repeat count grows */
+static int animenu_accelstep(unsigned int repeat) {
+  struct animenu_options* options = get_options();
+  if (options->accelpage > 0 && repeat >= options->accelpage) {
+    if (options->accelpercent > 0 && repeat >= options->accelpercent)
+      return(_max(currentmenu->itemcount / 10, 1));
+    return(_max(options->pagesize, 1));
+  }
+  return(1);
+}
+
+static void animenu_command(struct lirc_command *cmd, unsigned int repeat) {
+  int step;
+
+  struct animenu_options* options = get_options();
+
+  animenu_prewarmstop();
+  switch (cmd->id) {
+    case id_next:
+    case id_prev:
+    case id_pageup:
+    case id_pagedown:
+      if (currentmenu == NULL)
+        return;
+      if (cmd->id == id_next || cmd->id == id_prev)
+        step = cmd->argsread > 0 && cmd->value1 > 0 ? cmd->value1 : animenu_accelstep(repeat);
+      else
+        step = _max(options->pagesize, 1) * (cmd->argsread > 0 && cmd->value1 > 0 ? cmd->value1 : 1);
+      if (cmd->id == id_prev || cmd->id == id_pageup)
+        step = -step;
+      /* queued, see animenu_flushmoves */
+      pendingmoves += (step == 1 || step == -1) ? step : animenu_jumpdelta(step);
+      return;
+  }
+  animenu_flushmoves();
+
+  _tracestart(tracestart);
+  switch (cmd->id) {
+    case id_show:
+      if (rootmenu->visible) {
+        rootmenu->hide(rootmenu);
+        currentmenu = NULL;
+      } else if ((currentmenu = animenu_resume(rootmenu))) {
+        if (options->debug > 0)
+          printf("resumed | current item: '%s'\n",
+                 currentmenu->currentitem ? currentmenu->currentitem->title : "NULL");
+      } else {
+        rootmenu->show(rootmenu);
+        if (options->debug > 0)
+          printf("root | current item: '%s'\n",
+                 rootmenu->currentitem ? rootmenu->currentitem->title : "NULL");
+        rootmenu->next(rootmenu);
+        if (options->debug > 0)
+          printf("root | current item: '%s'\n",
+                 rootmenu->currentitem ? rootmenu->currentitem->title : "NULL");
+        /* navigate based on currentmenu */
+        currentmenu = rootmenu;
+      }
+      break;
+    case id_select:
+      if (currentmenu != NULL && currentmenu->currentitem != NULL)
+        currentmenu->currentitem->go(currentmenu->currentitem);
+      break;
+    case id_back:
+      if (currentmenu != NULL && currentmenu->parent != NULL) {
+        currentmenu->hide(currentmenu);
+        currentmenu = currentmenu->parent;
+        currentmenu->showcurrent(currentmenu);
+      }
+      break;
+    case id_jump:
+      animenu_typeahead(cmd->text, FALSE);
+      break;
+    case id_t9:
+      animenu_typeahead(cmd->text, TRUE);
+      break;
+    case id_home:
+      if (currentmenu != NULL)
+        currentmenu->seek(currentmenu, 0);
+      break;
+    case id_end:
+      if (currentmenu != NULL)
+        currentmenu->seek(currentmenu, -1);
+      break;
+    case id_forward:
+      if (currentmenu != NULL && currentmenu->currentitem != NULL) {
+        currentmenu->currentitem->select(currentmenu->currentitem);
+        if ((currentmenu->currentitem->menu != NULL) &&
+            (currentmenu->currentitem->menu->visible)) {
+          currentmenu = currentmenu->currentitem->menu;
+          if (currentmenu->currentitem->title) {
+            if (strstr(currentmenu->currentitem->title, playall) != 0)
+              currentmenu->next(currentmenu);
+          }
+          if (options->debug > 0)
+            printf("current item: '%s'\n", currentmenu->currentitem->title);
+        }
+      }
+      break;
+  }
+  animenu_resettimeout();
+  _traceend(tracestart, "command", cmd->name);
+}
+
+/* a repeat is stale when it belongs to a hold that has already ended,
+ * either because another button was pressed since, or because the
+ * repeat counter has gone back to zero for a fresh press of the same one */
+static int animenu_stalerepeat(const char *code, unsigned int *repeat) {
+  static char lastbutton[64] = "";
+  static unsigned int lastrepeat = 0;
+  char button[64];
+
+  *repeat = 0;
+  if (sscanf(code, "%*x %x %63s", repeat, button) != 2)
+    return(FALSE);
+  if (*repeat > 0 && (strcmp(button, lastbutton) != 0 || *repeat <= lastrepeat))
+    return(TRUE);
+  strcpy(lastbutton, button);
+  lastrepeat = *repeat;
+  return(FALSE);
+}
+
+/* drain everything lircd has sent. the socket is non-blocking, so
+ * lirc_nextcode hands back a NULL code once the buffer is empty. next
+ * and prev are folded into a single move which is rendered once the
+ * batch is exhausted, or before any other command needs the menu */
+static void animenu_lircinput(void *ud) {
+  char *code;
+  char *c;
+  int ret;
+  int codes = 0, stale = 0;
+  unsigned int repeat;
+
+  struct animenu_options* options = get_options();
+
+  while (lirc_nextcode(&code) == 0) {
+    if (code == NULL) {
+      if (options->debug > 1)
+        fprintf(stderr, "input batch: %d codes, %d stale, move %d\n",
+                codes, stale, pendingmoves);
+      animenu_flushmoves();
+      return;
+    }
+    ++codes;
+    if (lircconfig == NULL || animenu_stalerepeat(code, &repeat)) {
+      if (lircconfig)
+        ++stale;
+      free(code);
+      continue;
+    }
+    while ((ret = lirc_code2char(lircconfig, code, &c)) == 0 && c != NULL) {
+      struct lirc_command * cmd = parse_codes(lirc_commands,c);
+      if (!cmd)
+        fprintf(stderr, "command not recognised: %s\n", c);
+      else
+        animenu_command(cmd, repeat);
+    }
+    if (ret == -1)
+      fprintf(stderr, "animenu: lirc failed to process code: \n'%s'\n", code);
+    free(code);
+  }
+  /* lircd went away */
+  fprintf(stderr, "animenu: lost connection to lircd\n");
+  loop->quit(loop);
+}
+
+/* titles of the selected items down through the open menus */
+static void animenu_querypath(char *reply, int size) {
+  struct animenucontext *menu = rootmenu;
+  struct animenuitem *item;
+  int len = 0;
+
+  reply[0] = '\0';
+  while (menu && menu->visible && (item = menu->currentitem)) {
+    len += snprintf(reply + len, size - len, "/%s", item->title ? item->title : "");
+    if (len >= size)
+      break;
+    menu = item->menu;
+  }
+}
+
+/* a control socket line. either a command, as bound in lircrc, or a
+ * 'query' of the menu state */
+static int animenu_controlline(void *ud, const char *line, char *reply, int size) {
+  struct lirc_command *cmd;
+  char query[16];
+
+  if (sscanf(line, "query %15s", query) == 1) {
+    animenu_flushmoves();
+    if (strcmp(query, "visible") == 0)
+      snprintf(reply, size, "%d", rootmenu->visible ? 1 : 0);
+    else if (strcmp(query, "item") == 0)
+      snprintf(reply, size, "%s", currentmenu && currentmenu->currentitem &&
+                                  currentmenu->currentitem->title ?
+                                  currentmenu->currentitem->title : "");
+    else if (strcmp(query, "path") == 0)
+      animenu_querypath(reply, size);
+    else {
+      snprintf(reply, size, "error: unknown query '%s'", query);
+      return(FALSE);
+    }
+    return(TRUE);
+  }
+  if (!(cmd = parse_codes(lirc_commands, line))) {
+    snprintf(reply, size, "error: command not recognised");
+    return(FALSE);
+  }
+  animenu_command(cmd, 0);
+  return(TRUE);
+}
+
+static void animenu_controlbatch(void *ud) {
+  animenu_flushmoves();
+}
+
+static void animenu_xinput(void *ud) {
+  osd_events();
+}
+
+static void animenu_readlircrc() {
+  struct animenu_options* options = get_options();
+  if (lircconfig) {
+    lirc_freeconfig(lircconfig);
+    lircconfig = NULL;
+  }
+  if (lirc_readconfig(options->lircrcfile, &lircconfig, NULL) != 0)
+    lircconfig = NULL;
+  if (lircconfig == NULL)
+    fprintf(stderr, "cannot read lircrc file '%s'\n", options->lircrcfile);
+}
+
+/* the menu being navigated may have been replaced by a reload or a
+ * browse scan coming in, so find it again from the root */
+static void animenu_findcurrent() {
+  struct animenucontext *menu;
+
+  animenu_typeaheadreset(NULL);
+  currentmenu = NULL;
+  for (menu = rootmenu; menu && menu->visible;
+       menu = menu->currentitem ? menu->currentitem->menu : NULL)
+    currentmenu = menu;
+}
+
+/* swap in fresh copies of the menus read from 'name', leaving the rest
+ * of the tree, and what is on screen, as it was */
+static void animenu_reloadmenus(const char *name) {
+  char path[PATH_MAX];
+  int count;
+
+  struct animenu_options* options = get_options();
+
+  /* a path cut short would name some other file */
+  if (snprintf(path, PATH_MAX, "%s/%s", menudir, name) >= PATH_MAX) {
+    fprintf(stderr, "menu file path '%s/%s' too long, not reloaded\n", menudir, name);
+    return;
+  }
+  animenu_flushmoves();
+  count = animenu_reload(path);
+  if (options->debug > 0)
+    fprintf(stderr, "menu file '%s' has changed, %d menu(s) rebuilt\n", path, count);
+  animenu_findcurrent();
+}
+
+/* react to writes in the lircrc and menu directories. directories are
+ * watched rather than the files themselves so that editors replacing
+ * a file via rename are still seen */
+static void animenu_notify(void *ud) {
+  char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *event;
+  ssize_t len;
+  char *p;
+  char menus[16][NAME_MAX + 1];
+  int lircrc = FALSE, menucount = 0, i;
+
+  struct animenu_options* options = get_options();
+
+  while ((len = read(notifyfd, buf, sizeof(buf))) > 0) {
+    for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + event->len) {
+      event = (const struct inotify_event *) p;
+      if (!event->len)
+        continue;
+      if (event->wd == lircrcwatch && strcmp(event->name, lircrcname) == 0)
+        lircrc = TRUE;
+      if (event->wd == menuwatch && strlen(event->name) > 5 &&
+          strcmp(event->name + strlen(event->name) - 5, ".menu") == 0) {
+        /* an editor's save usually shows up as several events */
+        for (i = 0; i < menucount && strcmp(menus[i], event->name) != 0; ++i)
+          ;
+        if (i == menucount && menucount < 16) {
+          _strncpy(menus[menucount], event->name, NAME_MAX + 1);
+          ++menucount;
+        }
+      }
+    }
+  }
+
+  if (lircrc) {
+    if (options->debug > 0)
+      fprintf(stderr, "lircrc file '%s' has changed, re-reading\n", options->lircrcfile);
+    animenu_readlircrc();
+  }
+  for (i = 0; i < menucount; ++i)
+    animenu_reloadmenus(menus[i]);
+}
+
+static void animenu_watch() {
+  char dir[PATH_MAX];
+  char *s;
+
+  struct animenu_options* options = get_options();
+
+  if ((notifyfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+    fprintf(stderr, "cannot watch configuration files: %s\n", strerror(errno));
+    return;
+  }
+
+  _strncpy(dir, options->lircrcfile, PATH_MAX);
+  if ((s = strrchr(dir, '/'))) {
+    lircrcname = options->lircrcfile + (s - dir) + 1;
+    *s = '\0';
+    if (!*dir)
+      strcpy(dir, "/");
+  } else {
+    lircrcname = options->lircrcfile;
+    strcpy(dir, ".");
+  }
+  lircrcwatch = inotify_add_watch(notifyfd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+  _strncpy(menudir, rootfile, PATH_MAX);
+  if ((s = strrchr(menudir, '/')))
+    *s = '\0';
+  menuwatch = inotify_add_watch(notifyfd, menudir, IN_CLOSE_WRITE | IN_MOVED_TO);
+
+  loop->addfd(loop, notifyfd, animenu_notify, NULL);
+}
+
 int main(int argc, char *argv[]) {
-  struct lirc_config *config;
-  struct stat fstat, fstat_lircrc;
+  int lircfd;
 
   switch (process_options(argc, argv)) {
     case option_exitsuccess:
@@ -106,10 +574,12 @@ int main(int argc, char *argv[]) {
     return(EXIT_FAILURE);
   }
 
+  if (*options->tracefile && !trace_open(options->tracefile))
+    return(EXIT_FAILURE);
+
   /* create root menu */
-  char file[PATH_MAX] = "";
-  snprintf(file, PATH_MAX - 1, "%s/.animenu/%s", getenv("HOME"), "root.menu");
-  if (!animenu_initialise(&rootmenu, file)) {
+  snprintf(rootfile, PATH_MAX - 1, "%s/.animenu/%s", getenv("HOME"), "root.menu");
+  if (!animenu_initialise(&rootmenu, rootfile)) {
     fprintf(stderr, "cannot create root menu!\n");
     return(EXIT_FAILURE);
   }
@@ -118,126 +588,68 @@ int main(int argc, char *argv[]) {
     rootmenu->dispose(rootmenu);
     exit(0);
   }
+  if (*options->statefile)
+    animenu_loadstate(options->statefile);
 
-  if (options->menutimeout != 0)
-    signal(SIGALRM, sigalarm_handler);
-
-  if (lirc_init(options->progname, options->debug) == -1)
+  /* without lircd, the control socket can still drive the menu */
+  if ((lircfd = lirc_init(options->progname, options->debug)) == -1 &&
+      !*options->controlsocket)
     exit(EXIT_FAILURE);
 
   if (options->daemonise) {
     if (daemon(0, 0) == -1) {
       fprintf(stderr, "%s: can't daemonise\n", options->progname);
       perror(options->progname);
-      lirc_freeconfig(config);
-      lirc_deinit();
+      if (lircfd != -1)
+        lirc_deinit();
       exit(EXIT_FAILURE);
     }
   }
 
-  char *code;
-  char *c;
-  int ret;
-  config = NULL;
-  while (lirc_nextcode(&code) == 0) {
-    if (code == NULL)
-      continue;
+  if (!(loop = loop_create())) {
+    if (lircfd != -1)
+      lirc_deinit();
+    exit(EXIT_FAILURE);
+  }
+  animenu_setloop(loop);
+  animenu_setrefresh(animenu_findcurrent);
+  menutimer = loop->addtimer(loop, animenu_timeout, NULL);
+  typeaheadtimer = loop->addtimer(loop, animenu_typeaheadreset, NULL);
+  dwelltimer = loop->addtimer(loop, animenu_dwell, NULL);
+  if (lircfd != -1) {
+    fcntl(lircfd, F_SETFL, fcntl(lircfd, F_GETFL) | O_NONBLOCK);
+    loop->addfd(loop, lircfd, animenu_lircinput, NULL);
+    animenu_readlircrc();
+  }
+  if (*options->controlsocket) {
+    if (!(control = control_create(loop, options->controlsocket,
+                                   animenu_controlline, animenu_controlbatch, NULL)) &&
+        lircfd == -1)
+      exit(EXIT_FAILURE);
+  }
+  loop->addfd(loop, osd_connection(), animenu_xinput, NULL);
+  animenu_watch();
+  if (options->prewarm > 0 &&
+      (prewarm = prewarm_create(loop, options->prewarmdepth, animenu_prewarmdone, NULL))) {
+    prewarmtimer = loop->addtimer(loop, animenu_prewarmtick, NULL);
+    loop->settimer(loop, prewarmtimer, options->prewarm);
+  }
 
-    /* test config */
-    fstat = (struct stat){0};
-    stat((const char*)options->lircrcfile, &fstat);
-    if (config && (long unsigned int)difftime(fstat.st_mtime, fstat_lircrc.st_mtime) > 0) {
-      /* release config */
-      if (options->debug > 0)
-        fprintf(stderr, "lircrc file '%s' has changed, re-reading\n", options->lircrcfile);
-      lirc_freeconfig(config);
-      config = NULL;
-    }
-    if (config == NULL) {
-      /* (re)read config */
-      lirc_readconfig(options->lircrcfile, &config, NULL);
-      fstat_lircrc = (struct stat){0};
-      stat((const char*)options->lircrcfile, &fstat_lircrc);
-    }
-    if (config == NULL)
-      continue;
+  loop->run(loop);
 
-    while ((ret = lirc_code2char(config, code, &c)) == 0 && c != NULL) {
-      struct lirc_command * cmd = parse_codes(lirc_commands,c);
-      if (!cmd)
-        fprintf(stderr, "command not recognised: %s\n", c);
-      else {
-        if (options->menutimeout != 0)
-          alarm(0);
-        switch (cmd->id) {
-          case id_show:
-            if (rootmenu->visible) {
-              rootmenu->hide(rootmenu);
-              currentmenu = NULL;
-            } else {
-              rootmenu->show(rootmenu);
-              if (options->debug > 0)
-                printf("root | current item: '%s'\n",
-                       rootmenu->currentitem ? rootmenu->currentitem->title : "NULL");
-              rootmenu->next(rootmenu);
-              if (options->debug > 0)
-                printf("root | current item: '%s'\n",
-                       rootmenu->currentitem ? rootmenu->currentitem->title : "NULL");
-              /* navigate based on currentmenu */
-              currentmenu = rootmenu;
-            }
-            break;
-          case id_next:
-            if (currentmenu != NULL)
-              currentmenu->next(currentmenu);
-            break;
-          case id_prev:
-            if (currentmenu != NULL)
-              currentmenu->prev(currentmenu);
-            break;
-          case id_select:
-            if (currentmenu != NULL && currentmenu->currentitem != NULL)
-              currentmenu->currentitem->go(currentmenu->currentitem);
-            break;
-          case id_back:
-            if (currentmenu != NULL && currentmenu->parent != NULL) {
-              currentmenu->hide(currentmenu);
-              currentmenu = currentmenu->parent;
-              currentmenu->showcurrent(currentmenu);
-            }
-            break;
-          case id_forward:
-            if (currentmenu != NULL && currentmenu->currentitem != NULL) {
-              currentmenu->currentitem->select(currentmenu->currentitem);
-              if ((currentmenu->currentitem->menu != NULL) &&
-                  (currentmenu->currentitem->menu->visible)) {
-                currentmenu = currentmenu->currentitem->menu;
-                if (currentmenu->currentitem->title) {
-                  if (strstr(currentmenu->currentitem->title, playall) != 0)
-                    currentmenu->next(currentmenu);
-                }
-                if (options->debug > 0)
-                  printf("current item: '%s'\n", currentmenu->currentitem->title);
-              }
-            }
-            break;
-        }
-        if ((cmd->id == id_show) && !(rootmenu->visible))
-          ; /* no-op */
-        else if (options->menutimeout != 0) {
-          alarm_pending = 1;
-          alarm(options->menutimeout);
-        }
-      } /* valid command */
-    } /* while code2char */
-    free(code);
-    if (ret == -1)
-      fprintf(stderr, "animenu: lirc failed to process code: \n'%s'\n", code);
-  } /* while waiting for next lirc code */
-  lirc_freeconfig(config);
+  if (control)
+    control->dispose(control);
+  if (prewarm)
+    prewarm->dispose(prewarm);
+  loop->dispose(loop);
+  if (notifyfd != -1)
+    close(notifyfd);
+  if (lircconfig)
+    lirc_freeconfig(lircconfig);
 
   /* close lirc connection */
-  lirc_deinit();
+  if (lircfd != -1)
+    lirc_deinit();
 
   exit(EXIT_SUCCESS);
 }
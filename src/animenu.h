@@ -13,6 +13,7 @@
 #define ANIMENU_H
 
 #define _max(A,B) A>B?A:B
+#define _swap(T,A,B) do { T _t = A; A = B; B = _t; } while (0)
 #define _strncpy(A,B,C) strncpy(A,B,C), *(A+(C)-1)='\0'
 #define _strncat(A,B,C) strncat(A,B,C), *(A+(C)-1)='\0'
 
@@ -0,0 +1,208 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "control.h"
+
+#define CONTROL_READSIZE 4096
+
+struct controlclient {
+  int fd;
+  char line[CONTROL_MAXLINE + 1];
+  int len;
+  int overlong; /* discarding the rest of a line that didn't fit */
+  struct controlcontext *control;
+  struct controlclient *next;
+};
+
+struct controlprivate {
+  struct loopcontext *loop;
+  int fd;
+  char path[BUFSIZE + 1];
+  struct controlclient *clients;
+  int (*linecallback) (void *ud, const char *line, char *reply, int size);
+  void (*batchcallback) (void *ud);
+  void *userdata;
+};
+
+static void control_closeclient(struct controlclient *client) {
+  struct controlprivate *controlp = client->control->priv;
+  struct controlclient **c;
+  for (c = &controlp->clients; *c; c = &(*c)->next) {
+    if (*c == client) {
+      *c = client->next;
+      break;
+    }
+  }
+  controlp->loop->removefd(controlp->loop, client->fd);
+  close(client->fd);
+  free(client);
+}
+
+/* replies are short and rare, a client too slow to take one is dropped */
+static int control_reply(struct controlclient *client, const char *reply) {
+  size_t len = strlen(reply);
+  ssize_t sent;
+  while (len > 0) {
+    if ((sent = write(client->fd, reply, len)) == -1) {
+      if (errno == EINTR)
+        continue;
+      return(FALSE);
+    }
+    reply += sent;
+    len -= sent;
+  }
+  return(TRUE);
+}
+
+static void control_read(void *ud) {
+  struct controlclient *client = (struct controlclient *) ud;
+  struct controlprivate *controlp = client->control->priv;
+  char buf[CONTROL_READSIZE];
+  char reply[CONTROL_MAXLINE + 2];
+  ssize_t len;
+  int i, open = TRUE;
+
+  while ((len = read(client->fd, buf, sizeof(buf))) > 0) {
+    for (i = 0; i < len; ++i) {
+      if (buf[i] == '\n' || buf[i] == '\r') {
+        if (client->len > 0 && !client->overlong) {
+          client->line[client->len] = '\0';
+          reply[0] = '\0';
+          controlp->linecallback(controlp->userdata, client->line, reply, CONTROL_MAXLINE);
+          if (reply[0]) {
+            strcat(reply, "\n");
+            if (!control_reply(client, reply)) {
+              open = FALSE;
+              break;
+            }
+          }
+        }
+        client->len = 0;
+        client->overlong = FALSE;
+      } else if (client->len < CONTROL_MAXLINE)
+        client->line[client->len++] = buf[i];
+      else
+        client->overlong = TRUE;
+    }
+    if (!open)
+      break;
+  }
+  if (len == 0 || (len == -1 && errno != EAGAIN && errno != EINTR))
+    open = FALSE;
+
+  controlp->batchcallback(controlp->userdata);
+  if (!open)
+    control_closeclient(client);
+}
+
+static void control_accept(void *ud) {
+  struct controlcontext *control = (struct controlcontext *) ud;
+  struct controlclient *client;
+  int fd;
+
+  while ((fd = accept4(control->priv->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+    if (!(client = malloc(sizeof(struct controlclient)))) {
+      close(fd);
+      continue;
+    }
+    client->fd = fd;
+    client->len = 0;
+    client->overlong = FALSE;
+    client->control = control;
+    if (!control->priv->loop->addfd(control->priv->loop, fd, control_read, client)) {
+      close(fd);
+      free(client);
+      continue;
+    }
+    client->next = control->priv->clients;
+    control->priv->clients = client;
+  }
+}
+
+static void control_dispose(struct controlcontext *control) {
+  if (control) {
+    while (control->priv->clients)
+      control_closeclient(control->priv->clients);
+    if (control->priv->fd != -1) {
+      control->priv->loop->removefd(control->priv->loop, control->priv->fd);
+      close(control->priv->fd);
+      unlink(control->priv->path);
+    }
+    free(control->priv);
+    free(control);
+  }
+}
+
+struct controlcontext *control_create(struct loopcontext *loop, const char *path,
+                                      int (*linecallback) (void *userdata, const char *line,
+                                                           char *reply, int size),
+                                      void (*batchcallback) (void *userdata),
+                                      void *userdata) {
+  struct controlcontext *control;
+  struct controlprivate *controlp;
+  struct sockaddr_un addr;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "control socket path '%s' too long\n", path);
+    return(NULL);
+  }
+  if (!(control = malloc(sizeof(struct controlcontext)))) {
+    fprintf(stderr, "cannot allocate controlcontext!\n");
+    return(NULL);
+  }
+  if (!(controlp = malloc(sizeof(struct controlprivate)))) {
+    fprintf(stderr, "cannot allocate controlcontext!\n");
+    free(control);
+    return(NULL);
+  }
+  memset(controlp, 0, sizeof(struct controlprivate));
+  control->priv = controlp;
+  control->dispose = control_dispose;
+
+  controlp->loop = loop;
+  controlp->linecallback = linecallback;
+  controlp->batchcallback = batchcallback;
+  controlp->userdata = userdata;
+  _strncpy(controlp->path, path, BUFSIZE + 1);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  /* a stale socket from an earlier run would block the bind */
+  unlink(path);
+  if ((controlp->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+      bind(controlp->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+      chmod(path, S_IRUSR | S_IWUSR) == -1 ||
+      listen(controlp->fd, 8) == -1 ||
+      !loop->addfd(loop, controlp->fd, control_accept, control)) {
+    fprintf(stderr, "cannot create control socket '%s': %s\n", path, strerror(errno));
+    if (controlp->fd != -1) {
+      close(controlp->fd);
+      controlp->fd = -1;
+    }
+    control->dispose(control);
+    return(NULL);
+  }
+
+  return(control);
+}
@@ -0,0 +1,36 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_CONTROL_H
+#define ANIMENU_CONTROL_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+#include "loop.h"
+
+#define CONTROL_MAXLINE 256
+
+/* unix domain socket accepting newline separated commands. each line
+ * is handed to 'linecallback', which may fill 'reply' to have a line
+ * sent back. 'batchcallback' runs once everything a client had sent
+ * so far has been handled */
+struct controlcontext {
+  void (*dispose) (struct controlcontext *control);
+  struct controlprivate *priv;
+};
+
+struct controlcontext *control_create(struct loopcontext *loop, const char *path,
+                                      int (*linecallback) (void *userdata, const char *line,
+                                                           char *reply, int size),
+                                      void (*batchcallback) (void *userdata),
+                                      void *userdata);
+
+#endif
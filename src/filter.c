@@ -0,0 +1,202 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <regex.h>
+
+#include "filter.h"
+
+#define FILTER_MAXSUFFIXES 32
+
+/* what a directory means for the names in it, for a literal pattern */
+enum filter_scan {filter_none, filter_names, filter_all};
+
+struct filterprivate {
+  int refs;
+  int literal;
+  /* literal patterns */
+  char *prefix; /* the base path, ending in '/' */
+  char *suffixes[FILTER_MAXSUFFIXES]; /* each with its leading '.' */
+  int suffixcount;
+  int anchored; /* the pattern ends with '$' */
+  /* everything else */
+  regex_t regex;
+  int compiled;
+};
+
+/* whether 'name' has one of the suffixes, at the end when anchored */
+static int filter_suffixed(struct filterprivate *filterp, const char *name) {
+  size_t len = strlen(name), slen;
+  int i;
+  for (i = 0; i < filterp->suffixcount; ++i) {
+    if (filterp->anchored) {
+      slen = strlen(filterp->suffixes[i]);
+      if (len >= slen && strcasecmp(name + len - slen, filterp->suffixes[i]) == 0)
+        return(TRUE);
+    } else if (strcasestr(name, filterp->suffixes[i]))
+      return(TRUE);
+  }
+  return(FALSE);
+}
+
+/* the regex isn't anchored at the start, so the base path may be found
+ * anywhere in a directory's path, and unless anchored at the end a
+ * suffix anywhere after it matches. neither crosses a '/', so a
+ * directory decides whether none, all, or only the names with a suffix
+ * in them match */
+static int filter_scandir(struct filtercontext *filter, const char *dir) {
+  struct filterprivate *filterp = filter->priv;
+  size_t plen, i;
+  const char *rest;
+
+  if (!filterp->literal)
+    return(filter_names);
+  plen = strlen(filterp->prefix) - 1;
+  for (i = 0; dir[i]; ++i) {
+    if (strncasecmp(dir + i, filterp->prefix, plen) == 0 &&
+        (dir[i + plen] == '/' || dir[i + plen] == '\0'))
+      break;
+  }
+  if (!dir[i])
+    return(filter_none);
+  rest = dir + i + plen;
+  if (!filterp->anchored && filter_suffixed(filterp, rest))
+    return(filter_all);
+  return(filter_names);
+}
+
+static int filter_match(struct filtercontext *filter, int scan, const char *path, const char *name) {
+  struct filterprivate *filterp = filter->priv;
+  if (!filterp->literal)
+    return(filterp->compiled && regexec(&filterp->regex, path, 0, NULL, 0) == 0);
+  if (scan == filter_none)
+    return(FALSE);
+  if (scan == filter_all)
+    return(TRUE);
+  return(filter_suffixed(filterp, name));
+}
+
+/* recognise 'PREFIX.*\.(a|b|c)', 'PREFIX.*\.a' and either with '$',
+ * where PREFIX holds no regex syntax and ends with '/', and the
+ * suffixes are plain words */
+static int filter_analyse(struct filterprivate *filterp, const char *regex) {
+  const char *s, *list, *end;
+  char *suffix;
+  size_t len;
+
+  if (!(s = strstr(regex, ".*\\.")) || s == regex || s[-1] != '/')
+    return(FALSE);
+  if (strcspn(regex, "*.[]()|^$?+{}\\") != (size_t) (s - regex))
+    return(FALSE);
+  list = s + 4;
+  if (*list == '(') {
+    if (!(end = strchr(++list, ')')))
+      return(FALSE);
+    s = end + 1;
+  } else {
+    end = list + strcspn(list, "$");
+    /* an alternative outside brackets would take in the whole pattern */
+    if (memchr(list, '|', end - list))
+      return(FALSE);
+    s = end;
+  }
+  if (*s == '$') {
+    filterp->anchored = TRUE;
+    ++s;
+  }
+  if (*s)
+    return(FALSE);
+
+  while (list < end) {
+    len = strcspn(list, "|)$");
+    if (len == 0 || filterp->suffixcount == FILTER_MAXSUFFIXES)
+      return(FALSE);
+    if (!(suffix = malloc(len + 2)))
+      return(FALSE);
+    filterp->suffixes[filterp->suffixcount++] = suffix;
+    *suffix++ = '.';
+    for (; len > 0; --len, ++list) {
+      if (!isalnum(*list) && *list != '_' && *list != '-')
+        return(FALSE);
+      *suffix++ = *list;
+    }
+    *suffix = '\0';
+    if (*list == '|')
+      ++list;
+  }
+  if (filterp->suffixcount == 0 || !(filterp->prefix = strndup(regex, strstr(regex, ".*\\.") - regex)))
+    return(FALSE);
+  return(TRUE);
+}
+
+/* references are taken and dropped by scan threads as well */
+static struct filtercontext *filter_ref(struct filtercontext *filter) {
+  __atomic_add_fetch(&filter->priv->refs, 1, __ATOMIC_RELAXED);
+  return(filter);
+}
+
+static void filter_dispose(struct filtercontext *filter) {
+  struct filterprivate *filterp;
+  int i;
+  if (filter && __atomic_sub_fetch(&filter->priv->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    filterp = filter->priv;
+    for (i = 0; i < filterp->suffixcount; ++i)
+      free(filterp->suffixes[i]);
+    if (filterp->prefix)
+      free(filterp->prefix);
+    if (filterp->compiled)
+      regfree(&filterp->regex);
+    free(filterp);
+    free(filter);
+  }
+}
+
+struct filtercontext *filter_create(const char *regex) {
+  struct filtercontext *filter;
+  struct filterprivate *filterp;
+  int i;
+
+  if (!(filter = malloc(sizeof(struct filtercontext)))) {
+    fprintf(stderr, "cannot allocate filtercontext!\n");
+    return(NULL);
+  }
+  if (!(filterp = malloc(sizeof(struct filterprivate)))) {
+    fprintf(stderr, "cannot allocate filtercontext!\n");
+    free(filter);
+    return(NULL);
+  }
+  memset(filterp, 0, sizeof(struct filterprivate));
+  filter->priv = filterp;
+  filter->dispose = filter_dispose;
+  filter->ref = filter_ref;
+  filter->scandir = filter_scandir;
+  filter->match = filter_match;
+  filterp->refs = 1;
+
+  if (filter_analyse(filterp, regex))
+    filterp->literal = TRUE;
+  else {
+    /* not of the usual form, undo whatever was made of it */
+    for (i = 0; i < filterp->suffixcount; ++i)
+      free(filterp->suffixes[i]);
+    filterp->suffixcount = 0;
+    filterp->anchored = FALSE;
+    if (regcomp(&filterp->regex, regex, REG_EXTENDED | REG_ICASE | REG_NOSUB) == 0)
+      filterp->compiled = TRUE;
+    else
+      fprintf(stderr, "invalid browse pattern '%s', nothing will match\n", regex);
+  }
+
+  return(filter);
+}
@@ -0,0 +1,38 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_FILTER_H
+#define ANIMENU_FILTER_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+
+/* a browse pattern, analysed once when the browse item is created.
+ * patterns of the usual form, a literal base path followed by
+ * '.*\.(ext|ext..)', are matched as a set of suffixes against each
+ * name. anything else goes through the regex engine, compiled once.
+ * matching is case insensitive either way.
+ *
+ * 'scandir' looks at a directory once per scan and its result is
+ * passed on to 'match' for each entry, along with the entry's full path
+ * and name. filters are shared by the sub menus of a browse item, and
+ * freed once the last reference is disposed, from whichever thread */
+struct filtercontext {
+  void (*dispose) (struct filtercontext *filter);
+  struct filtercontext *(*ref) (struct filtercontext *filter);
+  int (*scandir) (struct filtercontext *filter, const char *dir);
+  int (*match) (struct filtercontext *filter, int scan, const char *path, const char *name);
+  struct filterprivate *priv;
+};
+
+struct filtercontext *filter_create(const char *regex);
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "generator.h"
+#include "menu.h"
+#include "trace.h"
+
+#define GENERATOR_READSIZE 4096
+#define _freecfg(A) free((void*)A[0]),free((void*)A)
+
+struct generatorprivate {
+  struct loopcontext *loop;
+  struct looptimer *timer;
+  pid_t pid;
+  int fd;
+  char *command;
+  char line[BUFSIZE + 1];
+  int len;
+  struct menureader reader;
+  long tracestart;
+  void (*itemcallback) (void *ud, char **itemcfg);
+  void (*batchcallback) (void *ud);
+  void (*donecallback) (void *ud, int complete);
+  void *userdata;
+};
+
+/* stop the program, if it's still going, and release everything
+ * without any further callbacks */
+static void generator_dispose(struct generatorcontext *generator) {
+  struct generatorprivate *genp;
+  if (generator) {
+    genp = generator->priv;
+    if (genp->fd != -1) {
+      genp->loop->removefd(genp->loop, genp->fd);
+      close(genp->fd);
+    }
+    if (genp->timer)
+      genp->loop->removetimer(genp->loop, genp->timer);
+    if (genp->pid > 0) {
+      /* the program runs in its own process group, take any children too */
+      if (kill(-genp->pid, SIGKILL) == -1)
+        kill(genp->pid, SIGKILL);
+      while (waitpid(genp->pid, NULL, 0) == -1 && errno == EINTR)
+        ;
+    }
+    animenu_readmenudone(&genp->reader);
+    if (genp->command)
+      free(genp->command);
+    free(genp);
+    free(generator);
+  }
+}
+
+static void generator_finish(struct generatorcontext *generator, int complete) {
+  struct generatorprivate *genp = generator->priv;
+  int status;
+
+  /* a program that has closed its output is done, whether it knows it or not */
+  if (genp->pid > 0 && waitpid(genp->pid, &status, WNOHANG) == genp->pid) {
+    genp->pid = 0;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      complete = FALSE;
+  }
+  _traceend(genp->tracestart, "exec", genp->command);
+  genp->donecallback(genp->userdata, complete);
+  generator->dispose(generator);
+}
+
+static void generator_item(struct generatorprivate *genp, const char *line) {
+  char **itemcfg;
+  if (animenu_readmenuline(&genp->reader, line, &itemcfg)) {
+    genp->itemcallback(genp->userdata, itemcfg);
+    _freecfg(itemcfg);
+  }
+}
+
+static void generator_read(void *ud) {
+  struct generatorcontext *generator = (struct generatorcontext *) ud;
+  struct generatorprivate *genp = generator->priv;
+  char buf[GENERATOR_READSIZE];
+  ssize_t len;
+  int i;
+
+  while ((len = read(genp->fd, buf, sizeof(buf))) > 0) {
+    for (i = 0; i < len; ++i) {
+      /* overlong lines are cut short, as in menu files */
+      if (genp->len < BUFSIZE)
+        genp->line[genp->len++] = buf[i];
+      if (buf[i] == '\n') {
+        genp->line[genp->len] = '\0';
+        generator_item(genp, genp->line);
+        genp->len = 0;
+      }
+    }
+  }
+  if (len == -1 && (errno == EAGAIN || errno == EINTR)) {
+    genp->batchcallback(genp->userdata);
+    return;
+  }
+
+  /* end of output, or an error reading it */
+  if (genp->len > 0) {
+    genp->line[genp->len] = '\0';
+    generator_item(genp, genp->line);
+  }
+  generator_item(genp, NULL);
+  genp->batchcallback(genp->userdata);
+  generator_finish(generator, len == 0);
+}
+
+static void generator_timeout(void *ud) {
+  struct generatorcontext *generator = (struct generatorcontext *) ud;
+  fprintf(stderr, "menu program '%s' timed out\n", generator->priv->command);
+  /* keep the last item, its lines may be all there */
+  generator_item(generator->priv, NULL);
+  generator->priv->batchcallback(generator->priv->userdata);
+  generator_finish(generator, FALSE);
+}
+
+struct generatorcontext *generator_create(struct loopcontext *loop, const char *command,
+                                          int timeout,
+                                          void (*itemcallback) (void *userdata, char **itemcfg),
+                                          void (*batchcallback) (void *userdata),
+                                          void (*donecallback) (void *userdata, int complete),
+                                          void *userdata) {
+  struct generatorcontext *generator;
+  struct generatorprivate *genp;
+  int fds[2], null;
+
+  if (!(generator = malloc(sizeof(struct generatorcontext)))) {
+    fprintf(stderr, "cannot allocate generatorcontext!\n");
+    return(NULL);
+  }
+  if (!(genp = malloc(sizeof(struct generatorprivate)))) {
+    fprintf(stderr, "cannot allocate generatorcontext!\n");
+    free(generator);
+    return(NULL);
+  }
+  memset(genp, 0, sizeof(struct generatorprivate));
+  generator->priv = genp;
+  generator->dispose = generator_dispose;
+
+  genp->loop = loop;
+  genp->fd = -1;
+  genp->itemcallback = itemcallback;
+  genp->batchcallback = batchcallback;
+  genp->donecallback = donecallback;
+  genp->userdata = userdata;
+  genp->tracestart = trace_enabled ? trace_now() : 0;
+
+  if (!(genp->command = strdup(command)) || pipe2(fds, O_CLOEXEC) == -1) {
+    fprintf(stderr, "cannot run menu program '%s': %s\n", command, strerror(errno));
+    generator->dispose(generator);
+    return(NULL);
+  }
+  if ((genp->pid = fork()) == 0) {
+    /* child, with output to the pipe and no input */
+    setpgid(0, 0);
+    dup2(fds[1], STDOUT_FILENO);
+    if ((null = open("/dev/null", O_RDONLY)) != -1)
+      dup2(null, STDIN_FILENO);
+    execl("/bin/sh", "sh", "-c", command, (char *) NULL);
+    _exit(127);
+  }
+  /* set from both sides, so the group exists whichever runs first */
+  if (genp->pid > 0)
+    setpgid(genp->pid, genp->pid);
+  close(fds[1]);
+  genp->fd = fds[0];
+  if (genp->pid == -1) {
+    fprintf(stderr, "cannot run menu program '%s': %s\n", command, strerror(errno));
+    generator->dispose(generator);
+    return(NULL);
+  }
+
+  fcntl(genp->fd, F_SETFL, fcntl(genp->fd, F_GETFL) | O_NONBLOCK);
+  if (!loop->addfd(loop, genp->fd, generator_read, generator)) {
+    generator->dispose(generator);
+    return(NULL);
+  }
+  if (timeout > 0) {
+    if ((genp->timer = loop->addtimer(loop, generator_timeout, generator)))
+      loop->settimer(loop, genp->timer, timeout);
+  }
+
+  return(generator);
+}
@@ -0,0 +1,37 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_GENERATOR_H
+#define ANIMENU_GENERATOR_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+#include "loop.h"
+
+/* a program whose output, in menu file format, is read through the
+ * main loop as it arrives. each complete item is handed to
+ * 'itemcallback', 'batchcallback' runs after each read, and
+ * 'donecallback' once at the end. 'complete' is FALSE if the program
+ * timed out, failed, or its output couldn't be read. the generator
+ * disposes of itself after 'donecallback' */
+struct generatorcontext {
+  void (*dispose) (struct generatorcontext *generator);
+  struct generatorprivate *priv;
+};
+
+struct generatorcontext *generator_create(struct loopcontext *loop, const char *command,
+                                          int timeout,
+                                          void (*itemcallback) (void *userdata, char **itemcfg),
+                                          void (*batchcallback) (void *userdata),
+                                          void (*donecallback) (void *userdata, int complete),
+                                          void *userdata);
+
+#endif
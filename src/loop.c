@@ -0,0 +1,275 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "loop.h"
+
+#define LOOP_MAXEVENTS 16
+
+struct loophandler {
+  int fd;
+  void (*callback) (void *userdata);
+  void *userdata;
+  struct loophandler *next;
+};
+
+struct looptimer {
+  long deadline; /* monotonic msecs, 0 when disarmed */
+  void (*callback) (void *userdata);
+  void *userdata;
+  struct looptimer *next;
+};
+
+struct loopprivate {
+  int epollfd;
+  int timerfd;
+  long armed; /* deadline the timerfd is currently set for */
+  int running;
+  struct loophandler *handlers;
+  struct looptimer *timers;
+};
+
+long loop_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void loop_arm(struct loopcontext *loop, long deadline) {
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  if (deadline > 0) {
+    its.it_value.tv_sec = deadline / 1000;
+    its.it_value.tv_nsec = (deadline % 1000) * 1000000;
+  }
+  timerfd_settime(loop->priv->timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+  loop->priv->armed = deadline;
+}
+
+/* run expired timers and re-arm the timerfd for the earliest remaining
+ * deadline. timers which were pushed back since the timerfd was armed
+ * are simply found to be not yet due */
+static void loop_timers(void *ud) {
+  struct loopcontext *loop = (struct loopcontext *) ud;
+  struct looptimer *timer;
+  unsigned long long expirations;
+  long now, next;
+
+  if (read(loop->priv->timerfd, &expirations, sizeof(expirations)) == -1 &&
+      errno != EAGAIN)
+    fprintf(stderr, "loop: timerfd read failed: %s\n", strerror(errno));
+  loop->priv->armed = 0;
+
+  now = loop_now();
+  for (timer = loop->priv->timers; timer; timer = timer->next) {
+    if (timer->callback && timer->deadline > 0 && timer->deadline <= now) {
+      timer->deadline = 0;
+      timer->callback(timer->userdata);
+    }
+  }
+
+  next = 0;
+  for (timer = loop->priv->timers; timer; timer = timer->next) {
+    if (timer->deadline > 0 && (next == 0 || timer->deadline < next))
+      next = timer->deadline;
+  }
+  if (next > 0)
+    loop_arm(loop, next);
+}
+
+static int loop_addfd(struct loopcontext *loop, int fd,
+                      void (*callback) (void *userdata), void *userdata) {
+  struct loophandler *handler;
+  struct epoll_event ev;
+
+  if (!(handler = malloc(sizeof(struct loophandler))))
+    return(FALSE);
+  handler->fd = fd;
+  handler->callback = callback;
+  handler->userdata = userdata;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = handler;
+  if (epoll_ctl(loop->priv->epollfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+    fprintf(stderr, "loop: cannot watch fd %d: %s\n", fd, strerror(errno));
+    free(handler);
+    return(FALSE);
+  }
+  handler->next = loop->priv->handlers;
+  loop->priv->handlers = handler;
+
+  return(TRUE);
+}
+
+static void loop_removefd(struct loopcontext *loop, int fd) {
+  struct loophandler *handler;
+  for (handler = loop->priv->handlers; handler; handler = handler->next) {
+    if (handler->fd == fd) {
+      epoll_ctl(loop->priv->epollfd, EPOLL_CTL_DEL, fd, NULL);
+      /* released once the current dispatch completes */
+      handler->fd = -1;
+      return;
+    }
+  }
+}
+
+static struct looptimer *loop_addtimer(struct loopcontext *loop,
+                                       void (*callback) (void *userdata), void *userdata) {
+  struct looptimer *timer;
+  if (!(timer = malloc(sizeof(struct looptimer))))
+    return(NULL);
+  timer->deadline = 0;
+  timer->callback = callback;
+  timer->userdata = userdata;
+  timer->next = loop->priv->timers;
+  loop->priv->timers = timer;
+  return(timer);
+}
+
+/* (re)set a timer 'msecs' from now, or disarm it with 0. the timerfd
+ * is only touched when the new deadline is earlier than the armed one,
+ * so repeatedly pushing a timeout back costs no syscalls */
+static void loop_settimer(struct loopcontext *loop, struct looptimer *timer, int msecs) {
+  if (msecs <= 0) {
+    timer->deadline = 0;
+    return;
+  }
+  timer->deadline = loop_now() + msecs;
+  if (loop->priv->armed == 0 || timer->deadline < loop->priv->armed)
+    loop_arm(loop, timer->deadline);
+}
+
+/* released once the current dispatch completes, as for fds */
+static void loop_removetimer(struct loopcontext *loop, struct looptimer *timer) {
+  timer->deadline = 0;
+  timer->callback = NULL;
+}
+
+static void loop_reap(struct loopcontext *loop) {
+  struct loophandler **handler = &loop->priv->handlers;
+  struct loophandler *dead;
+  struct looptimer **timer = &loop->priv->timers;
+  struct looptimer *deadtimer;
+  while (*handler) {
+    if ((*handler)->fd == -1) {
+      dead = *handler;
+      *handler = dead->next;
+      free(dead);
+    } else
+      handler = &(*handler)->next;
+  }
+  while (*timer) {
+    if (!(*timer)->callback) {
+      deadtimer = *timer;
+      *timer = deadtimer->next;
+      free(deadtimer);
+    } else
+      timer = &(*timer)->next;
+  }
+}
+
+static int loop_run(struct loopcontext *loop) {
+  struct epoll_event events[LOOP_MAXEVENTS];
+  struct loophandler *handler;
+  int count, i;
+
+  loop->priv->running = TRUE;
+  while (loop->priv->running) {
+    count = epoll_wait(loop->priv->epollfd, events, LOOP_MAXEVENTS, -1);
+    if (count == -1) {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "loop: epoll_wait failed: %s\n", strerror(errno));
+      return(FALSE);
+    }
+    for (i = 0; i < count; ++i) {
+      handler = (struct loophandler *) events[i].data.ptr;
+      if (handler->fd != -1)
+        handler->callback(handler->userdata);
+    }
+    loop_reap(loop);
+  }
+
+  return(TRUE);
+}
+
+static void loop_quit(struct loopcontext *loop) {
+  loop->priv->running = FALSE;
+}
+
+static void loop_dispose(struct loopcontext *loop) {
+  struct loophandler *handler;
+  struct looptimer *timer;
+  if (loop) {
+    while ((handler = loop->priv->handlers)) {
+      loop->priv->handlers = handler->next;
+      free(handler);
+    }
+    while ((timer = loop->priv->timers)) {
+      loop->priv->timers = timer->next;
+      free(timer);
+    }
+    if (loop->priv->timerfd != -1)
+      close(loop->priv->timerfd);
+    if (loop->priv->epollfd != -1)
+      close(loop->priv->epollfd);
+    free(loop->priv);
+    free(loop);
+  }
+}
+
+struct loopcontext *loop_create() {
+  struct loopcontext *loop;
+  struct loopprivate *loopp;
+
+  if (!(loop = malloc(sizeof(struct loopcontext)))) {
+    fprintf(stderr, "cannot allocate loopcontext!\n");
+    return(NULL);
+  }
+  if (!(loopp = malloc(sizeof(struct loopprivate)))) {
+    fprintf(stderr, "cannot allocate loopcontext!\n");
+    free(loop);
+    return(NULL);
+  }
+  memset(loopp, 0, sizeof(struct loopprivate));
+  loop->priv = loopp;
+
+  loop->dispose = loop_dispose;
+  loop->addfd = loop_addfd;
+  loop->removefd = loop_removefd;
+  loop->addtimer = loop_addtimer;
+  loop->settimer = loop_settimer;
+  loop->removetimer = loop_removetimer;
+  loop->run = loop_run;
+  loop->quit = loop_quit;
+
+  loopp->epollfd = epoll_create1(EPOLL_CLOEXEC);
+  loopp->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (loopp->epollfd == -1 || loopp->timerfd == -1) {
+    fprintf(stderr, "loop: cannot create event descriptors: %s\n", strerror(errno));
+    loop->dispose(loop);
+    return(NULL);
+  }
+  if (!loop->addfd(loop, loopp->timerfd, loop_timers, loop)) {
+    loop->dispose(loop);
+    return(NULL);
+  }
+
+  return(loop);
+}
@@ -0,0 +1,37 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_LOOP_H
+#define ANIMENU_LOOP_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+
+struct looptimer;
+
+struct loopcontext {
+  void (*dispose) (struct loopcontext *loop);
+  int (*addfd) (struct loopcontext *loop, int fd,
+                void (*callback) (void *userdata), void *userdata);
+  void (*removefd) (struct loopcontext *loop, int fd);
+  struct looptimer *(*addtimer) (struct loopcontext *loop,
+                                 void (*callback) (void *userdata), void *userdata);
+  void (*settimer) (struct loopcontext *loop, struct looptimer *timer, int msecs);
+  void (*removetimer) (struct loopcontext *loop, struct looptimer *timer);
+  int (*run) (struct loopcontext *loop);
+  void (*quit) (struct loopcontext *loop);
+  struct loopprivate *priv;
+};
+
+struct loopcontext *loop_create();
+long loop_now();
+
+#endif
@@ -21,53 +21,58 @@
 #include <dirent.h>
 
 #include "menu.h"
+#include "preload.h"
+#include "trace.h"
 
 #define _freecfg(A) free((void*)A[0]),free((void*)A)
 
+/* msecs a browse scan is waited for before its menu is shown without it */
+#define ANIMENU_SCANGRACE 100
+/* msecs a speculative listing is opened as it is, without a rescan */
+#define ANIMENU_SCANFRESH 5000
+/* msecs an exec menu's new items are gathered before its osd is rebuilt */
+#define ANIMENU_EXECREBUILD 150
+
 /* globals */
 const char *playall = "| play all |";
 
 struct animenuitem *animenu_createitem(enum animenuitem_type type,
                                               char *title, char *path, char *regex,
                                               char *command, int recurse);
-struct animenucontext *animenu_createmenu(const char *path);
-struct animenucontext *animenu_createfilesystem(char *path, char *regex,
-                                                       char *command, int recurse);
 int animenu_additem(struct animenucontext *menu, struct animenuitem *item);
 
 void animenu_disposeitem(struct animenuitem *mi);
 void animenu_disposemenu(struct animenucontext *menu);
 
-int animenu_genosd(struct animenucontext *menu);
 void animenu_show(struct animenucontext *menu);
 void animenu_showcurrent(struct animenucontext *menu);
 void animenu_hide(struct animenucontext *menu);
 void animenu_hideframe(struct animenucontext *menu, int frame);
+void animenu_remember(struct animenucontext *root);
 
 void animenu_go(struct animenuitem *mi);
 void animenu_select(struct animenuitem *mi);
 void animenu_prev(struct animenucontext *menu);
 void animenu_next(struct animenucontext *menu);
+void animenu_move(struct animenucontext *menu, int delta);
+void animenu_seek(struct animenucontext *menu, int index);
+int animenu_jump(struct animenucontext *menu, const char *prefix, int t9);
 
 void *animenu_thread(void *ud);
 void *animenu_idcallback(void *ud, struct osditemdata **osdid);
-int animenu_readmenufile(FILE *f, char ***item);
 char *animenu_stripwhitespace(char *string);
 
 char *rx_start(char *s, char **first);
-int rx_compare(const char *s1, const char *s2);
 
 int animenu_initialise(struct animenucontext **rootmenu, const char *path) {
   int success = TRUE;
 
   /* create root menu */
-  if ((*rootmenu = animenu_createmenu(path)))
+  if ((*rootmenu = animenu_buildtree(path)))
     /* generate osd frames */
     animenu_genosd(*rootmenu);
-  else {
+  else
     success = FALSE;
-    (*rootmenu)->dispose(*rootmenu);
-  }
 
   return(success);
 }
@@ -84,6 +89,8 @@ void animenu_dump(struct animenucontext *menu) {
         printf("..");
       if (item->type == animenuitem_command)
         printf("[%s], [%s]\n", item->title, item->command);
+      if (item->type == animenuitem_exec)
+        printf("[%s], exec: [%s]\n", item->title, item->command);
       if (item->type == animenuitem_menu) {
         ++tab;
         printf("[%s], menu:\n", item->title);
@@ -101,6 +108,10 @@ struct animenuitem *animenu_createitem(enum animenuitem_type type, char *title,
   struct animenuitem *item;
   if (!(item = malloc(sizeof(struct animenuitem))))
     return(NULL);
+  _tracecount(trace_items, 1);
+  _tracecount(trace_bytes, sizeof(struct animenuitem) +
+                           (title ? strlen(title) + 1 : 0) + (path ? strlen(path) + 1 : 0) +
+                           (regex ? strlen(regex) + 1 : 0) + (command ? strlen(command) + 1 : 0));
 
   item->go = animenu_go;
   item->select = animenu_select;
@@ -110,7 +121,16 @@ struct animenuitem *animenu_createitem(enum animenuitem_type type, char *title,
   item->path = NULL;
   item->regex = NULL;
   item->command = NULL;
+  item->icon = NULL;
   item->menu = NULL;
+  item->generator = NULL;
+  item->rebuild = NULL;
+  item->scanner = NULL;
+  item->filter = NULL;
+  item->pooled = FALSE;
+  item->ttl = 0;
+  item->expires = 0;
+  item->speculated = 0;
 
   item->next = NULL;
   item->prev = NULL;
@@ -123,6 +143,7 @@ struct animenuitem *animenu_createitem(enum animenuitem_type type, char *title,
     }
   }
   item->osddata.title = item->title;
+  item->osddata.icon = NULL;
 
   if (path) {
     if (!(item->path = strdup(path))) {
@@ -143,47 +164,57 @@ struct animenuitem *animenu_createitem(enum animenuitem_type type, char *title,
     }
   }
 
-  /* create menu */
-  if (type == animenuitem_menu) {
-    struct animenucontext *menu;
-    if ((menu = animenu_createmenu(path))) {
-      /* connect new sub-menu to its item */
-      item->menu = menu;
-      /* generate osd frames */
-      animenu_genosd(menu);
-    } else {
-      menu->dispose(menu);
+  /* create stub for dynamic filesystem menu, its pattern ready for use */
+  if (type == animenuitem_filesystem) {
+    item->recurse = recurse;
+    if (regex && !(item->filter = filter_create(regex))) {
       item->dispose(item);
       return(NULL);
     }
   }
 
-  /* create stub for dynamic filesystem menu */
-  if (type == animenuitem_filesystem)
-    item->recurse = recurse;
-
   return(item);
 }
 
-/* create menu content */
-struct animenucontext *animenu_createmenu(const char *path) {
+/* menus read from files, so a file referenced from several places is
+ * read once and shared */
+static struct animenucontext *animenu_interned = NULL;
+static int animenu_generation = 0;
+
+/* exec menus are read through the main loop, without one they can't run */
+static struct loopcontext *animenu_loop = NULL;
+
+/* menu files already read, while the tree is being built */
+static struct preloadcontext *animenu_preload = NULL;
+
+/* told when menus change under the one being navigated */
+static void (*animenu_refresh) () = NULL;
 
+void animenu_setloop(struct loopcontext *loop) {
+  animenu_loop = loop;
+}
+
+void animenu_setrefresh(void (*refresh) ()) {
+  animenu_refresh = refresh;
+}
+
+/* an empty menu */
+static struct animenucontext *animenu_newmenu() {
   struct animenucontext *menu;
-  struct animenuitem *item;
-  char *type, *title;
-  char **itemcfg;
-  char pathbase[PATH_MAX + 1];
-  FILE *f;
 
   struct animenu_options* options = get_options();
 
   if (!(menu = malloc(sizeof(struct animenucontext))))
     return(NULL);
   memset(menu, 0, sizeof(struct animenucontext));
+  _tracecount(trace_bytes, sizeof(struct animenucontext));
 
   menu->dispose = animenu_disposemenu;
   menu->next = animenu_next;
   menu->prev = animenu_prev;
+  menu->move = animenu_move;
+  menu->seek = animenu_seek;
+  menu->jump = animenu_jump;
   menu->show = animenu_show;
   menu->showcurrent = animenu_showcurrent;
   menu->hide = animenu_hide;
@@ -193,197 +224,480 @@ struct animenucontext *animenu_createmenu(const char *path) {
   menu->currentitem = NULL;
   menu->osd = NULL;
   menu->menuanimation = options->menuanimation;
+  menu->refs = 1;
 
-  if (!(f = fopen(path, "r"))) {
-    /* cannot open file */
-    menu->dispose(menu);
-    return(NULL);
+  return(menu);
+}
+
+/* whether a menu being read is reachable from 'menu', in which case
+ * adding 'menu' to it would close a loop */
+static int animenu_reaches(struct animenucontext *menu) {
+  struct animenuitem *item;
+  if (menu->parsing)
+    return(TRUE);
+  if (menu->visited == animenu_generation)
+    return(FALSE);
+  menu->visited = animenu_generation;
+  for (item = menu->firstitem; item; item = item->next) {
+    if (item->type == animenuitem_menu && item->menu && animenu_reaches(item->menu))
+      return(TRUE);
   }
+  return(FALSE);
+}
 
-  while (animenu_readmenufile(f, &itemcfg)) {
-    /* create an item */
-    type = itemcfg[0];
-    title = itemcfg[1];
-    if (strcmp(type, "item") == 0) {
-      /* set up a command item */
-      if ((item = animenu_createitem(animenuitem_command, title, NULL, NULL, itemcfg[2], 0)))
-        menu->additem(menu, item);
-      else
-        fprintf(stderr, "cannot create item '%s'\n", title);
-    } else if (strcmp(type, "menu") == 0) {
-      /* set up a menu item */
-      snprintf(pathbase, PATH_MAX, "%s/.animenu/%s", getenv("HOME"), itemcfg[2]);
-      if ((item = animenu_createitem(animenuitem_menu, title, pathbase, NULL, NULL, 0)))
-        menu->additem(menu, item);
-      else
-        fprintf(stderr, "cannot create sub menu '%s' from '%s'\n", title, itemcfg[2]);
-    } else if (strncasecmp(type, "browse", 6) == 0) {
-      /* set up a browse item */
-      int recurse;
-      if (strncasecmp(type, "browse_recurse", 14) == 0) {
-        /* return pointer 14 chars beyond the start of the buffer, thus the path */
-        strcpy(pathbase, animenu_stripwhitespace(type + 14));
-        recurse = 1;
-      } else {
-        strcpy(pathbase, animenu_stripwhitespace(type + 6));
-        recurse = 0;
-      }
-      /* the path is later derived from the regular expression */
-      if ((item = animenu_createitem(animenuitem_filesystem, title, NULL, pathbase, itemcfg[2], recurse)))
-        menu->additem(menu, item);
-      else
-        fprintf(stderr, "cannot create filesystem menu '%s' from '%s'\n", title, itemcfg[2]);
+static int animenu_cyclic(struct animenucontext *menu) {
+  ++animenu_generation;
+  return(animenu_reaches(menu));
+}
+
+/* any line after the third may give an icon, 'icon <file>', with
+ * relative paths taken from ~/.animenu */
+static void animenu_parseicon(struct animenuitem *item, char **itemcfg) {
+  char path[PATH_MAX + 1], *file;
+  int i;
+  for (i = 3; itemcfg[i]; ++i) {
+    if (strncasecmp(itemcfg[i], "icon", 4) != 0 || !isspace(itemcfg[i][4]))
+      continue;
+    file = animenu_stripwhitespace(itemcfg[i] + 4);
+    if (*file == '/')
+      _strncpy(path, file, PATH_MAX + 1);
+    else
+      animenu_menupath(path, file);
+    if (item->icon)
+      free(item->icon);
+    item->icon = strdup(path);
+    item->osddata.icon = item->icon;
+  }
+}
+
+/* add an item, as read from a menu file */
+static void animenu_parseitem(struct animenucontext *menu, char **itemcfg) {
+  struct animenuitem *item, *last = menu->lastitem;
+  struct animenucontext *submenu;
+  char *type, *title;
+  char pathbase[PATH_MAX + 1];
+  double ttl;
+
+  /* create an item */
+  type = itemcfg[0];
+  title = itemcfg[1];
+  if (strcmp(type, "item") == 0) {
+    /* set up a command item */
+    if ((item = animenu_createitem(animenuitem_command, title, NULL, NULL, itemcfg[2], 0)))
+      menu->additem(menu, item);
+    else
+      fprintf(stderr, "cannot create item '%s'\n", title);
+  } else if (strcmp(type, "menu") == 0) {
+    /* set up a menu item */
+    animenu_menupath(pathbase, itemcfg[2]);
+    if (!(submenu = animenu_createmenu(pathbase)))
+      fprintf(stderr, "cannot create sub menu '%s' from '%s'\n", title, itemcfg[2]);
+    else if (animenu_cyclic(submenu)) {
+      fprintf(stderr, "skipping sub menu '%s', '%s' leads back to '%s'\n",
+              title, itemcfg[2], menu->source ? menu->source : "itself");
+      submenu->dispose(submenu);
+    } else if ((item = animenu_createitem(animenuitem_menu, title, pathbase, NULL, NULL, 0))) {
+      item->menu = submenu;
+      menu->additem(menu, item);
+    } else {
+      fprintf(stderr, "cannot create sub menu '%s' from '%s'\n", title, itemcfg[2]);
+      submenu->dispose(submenu);
+    }
+  } else if (strncasecmp(type, "browse", 6) == 0) {
+    /* set up a browse item */
+    int recurse;
+    if (strncasecmp(type, "browse_recurse", 14) == 0) {
+      /* return pointer 14 chars beyond the start of the buffer, thus the path */
+      strcpy(pathbase, animenu_stripwhitespace(type + 14));
+      recurse = 1;
+    } else {
+      strcpy(pathbase, animenu_stripwhitespace(type + 6));
+      recurse = 0;
+    }
+    /* the path is later derived from the regular expression */
+    if ((item = animenu_createitem(animenuitem_filesystem, title, NULL, pathbase, itemcfg[2], recurse)))
+      menu->additem(menu, item);
+    else
+      fprintf(stderr, "cannot create filesystem menu '%s' from '%s'\n", title, itemcfg[2]);
+  } else if (strncasecmp(type, "exec", 4) == 0 && (!type[4] || isspace(type[4]))) {
+    /* set up a menu read from a program's output, kept for 'ttl' seconds */
+    if ((item = animenu_createitem(animenuitem_exec, title, NULL, NULL, itemcfg[2], 0))) {
+      item->ttl = sscanf(type + 4, "%lf", &ttl) == 1 ? ttl * 1000 : -1;
+      menu->additem(menu, item);
     } else
-      fprintf(stderr, "skipping '%s', unknown type '%s'!\n", title, type);
+      fprintf(stderr, "cannot create exec menu '%s' from '%s'\n", title, itemcfg[2]);
+  } else
+    fprintf(stderr, "skipping '%s', unknown type '%s'!\n", title, type);
+
+  if (menu->lastitem != last)
+    animenu_parseicon(menu->lastitem, itemcfg);
+}
+
+/* add the items described by a menu file */
+static void animenu_parseitems(struct animenucontext *menu, FILE *f) {
+  char **itemcfg;
+  while (animenu_readmenufile(f, &itemcfg)) {
+    animenu_parseitem(menu, itemcfg);
     /* clean up config item */
     _freecfg(itemcfg);
-  } /* end while */
-  fclose(f);
+  }
+}
 
-  return(menu);
+/* menu files named by menu items live in ~/.animenu */
+void animenu_menupath(char *path, const char *name) {
+  snprintf(path, PATH_MAX, "%s/.animenu/%s", getenv("HOME"), name);
 }
 
-/* create filesystem menu content */
-struct animenucontext *animenu_createfilesystem(char *path, char *regex,
-                                                       char *command, int recurse) {
+/* create menu content. menus are interned by file identity, so a file
+ * already read (by any path or link) is shared rather than read again.
+ * while building the tree, files come from those read ahead */
+struct animenucontext *animenu_createmenu(const char *path) {
+  struct animenucontext *menu;
+  const struct preloadfile *file = NULL;
+  struct stat statbuf;
+  char source[PATH_MAX + 1];
+  FILE *f = NULL;
+  int i;
+
+  if (stat(path, &statbuf) == -1 || !realpath(path, source))
+    return(NULL);
+  for (menu = animenu_interned; menu; menu = menu->nextinterned) {
+    if (menu->dev == statbuf.st_dev && menu->ino == statbuf.st_ino) {
+      ++menu->refs;
+      return(menu);
+    }
+  }
+
+  _tracestart(tracestart);
+  if (!(menu = animenu_newmenu()))
+    return(NULL);
+  if (animenu_preload)
+    file = animenu_preload->find(animenu_preload, statbuf.st_dev, statbuf.st_ino);
+  if (!(menu->source = strdup(source)) || (!file && !(f = fopen(path, "r")))) {
+    /* cannot open file */
+    menu->dispose(menu);
+    return(NULL);
+  }
+  menu->dev = statbuf.st_dev;
+  menu->ino = statbuf.st_ino;
+  menu->nextinterned = animenu_interned;
+  animenu_interned = menu;
+
+  menu->parsing = TRUE;
+  if (file) {
+    for (i = 0; i < file->itemcount; ++i)
+      animenu_parseitem(menu, file->items[i]);
+  } else {
+    animenu_parseitems(menu, f);
+    fclose(f);
+  }
+  menu->parsing = FALSE;
+  _traceend(tracestart, file ? "build" : "parse", path);
 
+  return(menu);
+}
+
+/* create the menu tree from the root menu file in two phases. all the
+ * files it leads to are first read in parallel, then the tree is built
+ * from them in file order. no osds are created, that is left to
+ * animenu_genosd on the X thread. files that couldn't be read ahead are
+ * read as the tree reaches them */
+struct animenucontext *animenu_buildtree(const char *path) {
   struct animenucontext *menu;
+
+  _tracestart(tracestart);
+  animenu_preload = preload_create(path);
+  menu = animenu_createmenu(path);
+  if (animenu_preload)
+    animenu_preload->dispose(animenu_preload);
+  animenu_preload = NULL;
+  _traceend(tracestart, "build tree", path);
+
+  return(menu);
+}
+
+/* append a string to a pool, returning its offset. offsets rather than
+ * pointers are handed out, as the buffer moves when it grows */
+static size_t animenu_pooladd(struct stringpool *pool, const char *s, size_t len) {
+  size_t offset = pool->len, size;
+  char *buf;
+  if (pool->len + len + 1 > pool->size) {
+    size = pool->size ? pool->size * 2 : 4096;
+    while (size < pool->len + len + 1)
+      size *= 2;
+    if (!(buf = realloc(pool->buf, size)))
+      return((size_t) -1);
+    _tracecount(trace_bytes, size - pool->size);
+    pool->buf = buf;
+    pool->size = size;
+  }
+  memcpy(pool->buf + pool->len, s, len);
+  pool->buf[pool->len + len] = '\0';
+  pool->len += len + 1;
+  return(offset);
+}
+
+/* icons for browse entries from 'icondir', '<extension>.xpm' for files
+ * falling back to 'file.xpm', and 'directory.xpm'. each extension is
+ * looked up once and its icon path kept, so the items just point at it */
+#define ANIMENU_MAXEXT 16
+
+struct fileicon {
+  char ext[ANIMENU_MAXEXT]; /* "/" for directories */
+  char *path; /* NULL for none */
+  struct fileicon *next;
+};
+
+static struct fileicon *animenu_fileicons = NULL;
+
+static const char *animenu_fileicon(const char *name, int dir) {
+  struct animenu_options* options = get_options();
+  struct fileicon *fileicon;
+  char ext[ANIMENU_MAXEXT], path[PATH_MAX + 1];
+  const char *dot;
+  int i;
+
+  if (!options->icondir[0])
+    return(NULL);
+  if (dir)
+    strcpy(ext, "/");
+  else if ((dot = strrchr(name, '.')) && strlen(dot + 1) < ANIMENU_MAXEXT) {
+    for (i = 0; dot[i + 1]; ++i)
+      ext[i] = tolower(dot[i + 1]);
+    ext[i] = '\0';
+  } else
+    ext[0] = '\0';
+
+  for (fileicon = animenu_fileicons; fileicon; fileicon = fileicon->next) {
+    if (strcmp(fileicon->ext, ext) == 0)
+      return(fileicon->path);
+  }
+  if (!(fileicon = malloc(sizeof(struct fileicon))))
+    return(NULL);
+  strcpy(fileicon->ext, ext);
+  snprintf(path, PATH_MAX, "%s/%s.xpm", options->icondir, dir ? "directory" : ext);
+  if (!ext[0] || (!dir && access(path, R_OK) == -1))
+    snprintf(path, PATH_MAX, "%s/file.xpm", options->icondir);
+  fileicon->path = access(path, R_OK) == 0 ? strdup(path) : NULL;
+  fileicon->next = animenu_fileicons;
+  animenu_fileicons = fileicon;
+  return(fileicon->path);
+}
+
+/* an item whose strings live in its menu's pool */
+static struct animenuitem *animenu_createpooled(enum animenuitem_type type, char *title,
+                                                char *path, char *regex, char *command,
+                                                int recurse) {
   struct animenuitem *item;
+  if (!(item = animenu_createitem(type, NULL, NULL, NULL, NULL, recurse)))
+    return(NULL);
+  item->pooled = TRUE;
+  item->title = item->osddata.title = title;
+  item->path = path;
+  item->regex = regex;
+  item->command = command;
+  return(item);
+}
+
+struct browselisting *animenu_reflisting(struct browselisting *listing) {
+  __atomic_add_fetch(&listing->refs, 1, __ATOMIC_RELAXED);
+  return(listing);
+}
+
+/* from whichever thread lets go last, a menu or a launch */
+void animenu_releaselisting(struct browselisting *listing) {
+  if (listing && __atomic_sub_fetch(&listing->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    if (listing->pool) {
+      free(listing->pool->buf);
+      free(listing->pool);
+    }
+    if (listing->filter)
+      listing->filter->dispose(listing->filter);
+    if (listing->files)
+      free(listing->files);
+    free(listing);
+  }
+}
+
+/* the directory a browse regex starts from, up to its first special
+ * character. caller must free */
+static char *animenu_basepath(const char *regex) {
+  char *pathbase, *rxs;
+
+  if (regex == NULL) {
+    fprintf(stderr, "cannot set base path");
+    return(NULL);
+  } else if (*regex != '/') {
+    fprintf(stderr, "cannot set base path from '%s', ensure it is fully qualified", regex);
+    return(NULL);
+  }
+  /* set base path */
+  if (!(pathbase = strdup(regex)))
+    return(NULL);
+  if (rx_start(pathbase, &rxs))
+    *rxs = '\0';
+  /* return pointer to last occurence of char in array
+   * and use this to terminate the string */
+  *strrchr(pathbase, '/') = '\0';
+  return(pathbase);
+}
+
+/* scan a browse directory. the names are packed into a string pool,
+ * after the base directory and the regex and command shared by every
+ * item, so a menu can be made of them without copying. 'filter' is the
+ * browse item's compiled pattern, or NULL to compile 'regex'. nothing
+ * here touches the menus, so it may run on a thread of its own */
+struct browselisting *animenu_scandir(const char *path, const char *regex,
+                                      struct filtercontext *filter,
+                                      const char *command, int recurse) {
+  struct browselisting *listing;
   DIR *d = NULL;
   struct stat statbuf;
   struct dirent *dirent;
-  char *title, *commandall;
-  char pathbase[BUFSIZE + 1], pathcur[BUFSIZE + 1];
-  unsigned int size;
-  struct files {
-    char file[PATH_MAX + 1];
-    struct files *next;
-  } *filecur, *fileroot = NULL, *fileprev = NULL;
+  struct stringpool *pool;
+  struct browsefile *files;
+  char *pathbase, *pathcur = NULL, *s;
+  size_t len, baselen, size = 0, offset;
+  int alloc = 0, scan, isfile, isdir;
 
-  if (path)
+  _tracestart(tracestart);
+  if (path) {
     /* path already set, so use that */
-    _strncpy(pathbase, path, BUFSIZE + 1);
-  else {
-    if (regex == NULL) {
-      fprintf(stderr, "cannot set base path");
-      return(FALSE);
-    } else if (*regex != '/') {
-      fprintf(stderr, "cannot set base path from '%s', ensure it is fully qualified", regex);
-      return(FALSE);
-    }
-    /* set base path */
-    _strncpy(pathbase, regex, BUFSIZE + 1);
-    char *rxs;
-    if (rx_start(pathbase, &rxs))
-      *rxs = '\0';
-    /* return pointer to last occurence of char in array
-     * and use this to terminate the string */
-    *strrchr(pathbase, '/') = '\0';
-  }
+    if (!(pathbase = strdup(path)))
+      return(NULL);
+  } else if (!(pathbase = animenu_basepath(regex)))
+    return(NULL);
 
   if (!(d = opendir(pathbase))) {
     fprintf(stderr, "invalid base path '%s'", pathbase);
-    return(FALSE);
+    free(pathbase);
+    return(NULL);
+  }
+  if (!(listing = calloc(1, sizeof(struct browselisting)))) {
+    closedir(d);
+    free(pathbase);
+    return(NULL);
+  }
+  listing->refs = 1;
+  if (!(pool = listing->pool = calloc(1, sizeof(struct stringpool))) ||
+      !(listing->filter = filter ? filter->ref(filter) : filter_create(regex))) {
+    animenu_releaselisting(listing);
+    closedir(d);
+    free(pathbase);
+    return(NULL);
+  }
+  listing->recurse = recurse;
+
+  /* the base path comes first, so paths are 'pool->buf' + name */
+  baselen = strlen(pathbase);
+  if (animenu_pooladd(pool, pathbase, baselen) == (size_t) -1 ||
+      (listing->regexat = animenu_pooladd(pool, regex, strlen(regex))) == (size_t) -1 ||
+      (listing->commandat = animenu_pooladd(pool, command, strlen(command))) == (size_t) -1) {
+    animenu_releaselisting(listing);
+    closedir(d);
+    free(pathbase);
+    return(NULL);
   }
-  /* fail if we can't allocate enough memory for the menu struct (known size) */
-  if (!(menu = malloc(sizeof(struct animenucontext))))
-    return(FALSE);
-  memset(menu, 0, sizeof(struct animenucontext));
-
-  /* function pointers */
-  menu->dispose = animenu_disposemenu;
-  menu->next = animenu_next;
-  menu->prev = animenu_prev;
-  menu->show = animenu_show;
-  menu->showcurrent = animenu_showcurrent;
-  menu->hide = animenu_hide;
-  menu->additem = animenu_additem;
-
-  menu->firstitem = NULL;
-  menu->currentitem = NULL;
-  menu->osd = NULL;
 
-  for (*pathcur = '\0'; (dirent = readdir(d));) {
+  scan = listing->filter->scandir(listing->filter, pathbase);
+  while ((dirent = readdir(d))) {
     /* use 'back' navigation to move up through the file hierarchy instead */
     if (!strcmp(dirent->d_name, "..") || !strcmp(dirent->d_name, "."))
       continue;
+    ++listing->entries;
+
+    /* the full path, for the regex and stat, and the pool */
+    len = baselen + strlen(dirent->d_name) + 2;
+    if (len > size) {
+      if (!(s = realloc(pathcur, len * 2)))
+        continue;
+      pathcur = s;
+      size = len * 2;
+    }
+    sprintf(pathcur, "%s/%s", pathbase, dirent->d_name);
 
-    /* set 'cur' as the current full path for consideration */
-    snprintf(pathcur, BUFSIZE + 1, "%s/%s", pathbase, dirent->d_name);
-
-    if (stat(pathcur, &statbuf) != -1) {
-      if (S_ISREG(statbuf.st_mode)) {
-        if (!rx_compare(pathcur, regex)) {
-          /* match the regex path */
-          if (!(filecur = malloc(sizeof(struct files))))
-            continue;
-          if (fileroot == NULL)
-            fileroot = filecur;
-          else
-            fileprev->next = filecur;
-
-          /* copy the path into the file struct's file variable */
-          _strncpy(filecur->file, pathcur, BUFSIZE + 1);
-          filecur->next = NULL;
-          fileprev = filecur;
-        }
-      } else if (S_ISDIR(statbuf.st_mode) || S_ISLNK(statbuf.st_mode)) {
-        if (recurse)
-          ; /* no-op */
-        else {
-          /* add the dir/link regardless of match */
-          if (!(filecur = malloc(sizeof(struct files))))
-            continue;
-          if (fileroot == NULL)
-            fileroot = filecur;
-          else
-            fileprev->next = filecur;
-          /* copy the path into our struct's file variable */
-          _strncpy(filecur->file, pathcur, BUFSIZE + 1);
-          filecur->next = NULL;
-          fileprev = filecur;
-        }
-      }
+    /* most filesystems give the type, links and the rest need a stat */
+    if (dirent->d_type == DT_REG || dirent->d_type == DT_DIR) {
+      isfile = dirent->d_type == DT_REG;
+      isdir = !isfile;
+    } else {
+      if (stat(pathcur, &statbuf) == -1)
+        continue;
+      isfile = S_ISREG(statbuf.st_mode);
+      isdir = S_ISDIR(statbuf.st_mode) || S_ISLNK(statbuf.st_mode);
+    }
+    if (isfile) {
+      if (!listing->filter->match(listing->filter, scan, pathcur, dirent->d_name))
+        continue;
+    } else if (!isdir || recurse)
+      continue;
+
+    /* keep the match, or the dir/link regardless of match */
+    if (listing->count == alloc) {
+      alloc = alloc ? alloc * 2 : 64;
+      if (!(files = realloc(listing->files, alloc * sizeof(struct browsefile))))
+        break;
+      _tracecount(trace_bytes, (alloc - listing->count) * sizeof(struct browsefile));
+      listing->files = files;
     }
+    if ((offset = animenu_pooladd(pool, pathcur + baselen, len - baselen - 1)) == (size_t) -1)
+      break;
+    listing->files[listing->count].name = offset;
+    listing->files[listing->count].dir = !isfile;
+    ++listing->count;
   }
   closedir(d);
+  if (pathcur)
+    free(pathcur);
+  _traceend(tracestart, "scan", pathbase);
+  free(pathbase);
 
-  /* create the browse menu's items
-   * either 'command' items or 'browse' (menu) items */
-  if (!*pathcur) {
-    menu->dispose(menu);
-    return(FALSE);
+  if (!listing->entries) {
+    animenu_releaselisting(listing);
+    return(NULL);
   }
-  if (fileroot) {
-    /* get the final size for the command + args string */
-    for (size = strlen(command) + 1, filecur = fileroot; filecur != NULL; filecur = filecur->next)
-      size += strlen(filecur->file) + 3;
+  return(listing);
+}
 
-    if (!(commandall = malloc(size + 1))) {
-      menu->dispose(menu);
-      return(FALSE);
-    }
-    _strncpy(commandall, command, size);
+/* create filesystem menu content from a scan, the menu taking over the
+ * caller's reference. items point into the listing's pool, and file
+ * paths are only put back together when one is run */
+struct animenucontext *animenu_listmenu(struct browselisting *listing) {
+  struct animenucontext *menu;
+  struct animenuitem *item;
+  struct stringpool *pool = listing->pool;
+  struct browsefile *files = listing->files;
+  char *s;
+  int i;
 
-    for (filecur = fileroot; filecur != NULL; filecur = filecur->next) {
-      _strncat(commandall, " \"", size);
-      _strncat(commandall, filecur->file, size);
-      _strncat(commandall, "\"", size);
-    }
+  if (!(menu = animenu_newmenu())) {
+    animenu_releaselisting(listing);
+    return(NULL);
+  }
+  menu->listing = listing;
+  /* browse menus open without animation */
+  menu->menuanimation = 0;
 
-    item = animenu_createitem(animenuitem_command, (char*)playall, NULL, NULL, commandall, 0);
-    menu->additem(menu, item);
-    for (filecur = fileroot; filecur != NULL; filecur = filecur->next) {
-      title = strrchr(filecur->file, '/');
-      stat(filecur->file, &statbuf);
-      if (S_ISREG(statbuf.st_mode)) {
+  /* create the browse menu's items
+   * either 'command' items or 'browse' (menu) items */
+  if (listing->count) {
+    /* the command for each file, or all of them, is made up when run */
+    item = animenu_createpooled(animenuitem_command, (char*)playall, NULL, NULL,
+                                pool->buf + listing->commandat, 0);
+    if (item)
+      menu->additem(menu, item);
+    for (i = 0; i < listing->count; ++i) {
+      s = pool->buf + files[i].name;
+      if (!files[i].dir)
         /* create command item */
-        snprintf(commandall, size, "%s \"%s\"", command, filecur->file);
-        item = animenu_createitem(animenuitem_command, ++title, NULL, NULL, commandall, 0);
-        menu->additem(menu, item);
-      } else if (S_ISDIR(statbuf.st_mode) || S_ISLNK(statbuf.st_mode)) {
+        item = animenu_createpooled(animenuitem_command, s + 1, s, NULL,
+                                    pool->buf + listing->commandat, 0);
+      else
         /* create menu item */
-        item = animenu_createitem(animenuitem_filesystem, title, filecur->file, regex, command, recurse);
+        item = animenu_createpooled(animenuitem_filesystem, s, s, pool->buf + listing->regexat,
+                                    pool->buf + listing->commandat, listing->recurse);
+      if (item) {
+        item->osddata.icon = animenu_fileicon(s + 1, files[i].dir);
         menu->additem(menu, item);
       }
     }
@@ -396,9 +710,35 @@ struct animenucontext *animenu_createfilesystem(char *path, char *regex,
   return(menu);
 }
 
+/* create filesystem menu content, scanning on the calling thread */
+struct animenucontext *animenu_createfilesystem(char *path, char *regex,
+                                                struct filtercontext *filter,
+                                                char *command, int recurse) {
+  struct browselisting *listing;
+  if (!(listing = animenu_scandir(path, regex, filter, command, recurse)))
+    return(NULL);
+  return(animenu_listmenu(listing));
+}
+
 int animenu_additem(struct animenucontext *menu, struct animenuitem *item) {
   int success = TRUE;
 
+  if (menu->itemcount == menu->itemsalloc) {
+    int size = menu->itemsalloc ? menu->itemsalloc * 2 : 16;
+    struct animenuitem **items;
+    if (!(items = realloc(menu->items, size * sizeof(struct animenuitem *))))
+      return(FALSE);
+    _tracecount(trace_bytes, (size - menu->itemsalloc) * sizeof(struct animenuitem *));
+    menu->items = items;
+    menu->itemsalloc = size;
+  }
+  item->index = menu->itemcount;
+  menu->items[menu->itemcount++] = item;
+  if (menu->search) {
+    search_dispose(menu->search);
+    menu->search = NULL;
+  }
+
   item->parent = menu;
   if (!(menu->firstitem))
     menu->firstitem = item;
@@ -414,7 +754,7 @@ int animenu_additem(struct animenucontext *menu, struct animenuitem *item) {
 }
 
 void animenu_disposeitem(struct animenuitem *mi) {
-  if (mi) {
+  if (mi && mi->parent) {
     if (mi->next)
       mi->next->prev = mi->prev;
     else
@@ -423,7 +763,21 @@ void animenu_disposeitem(struct animenuitem *mi) {
       mi->prev->next = mi->next;
     else
       mi->parent->firstitem = mi->next;
-
+    if (mi->parent->items) {
+      int i;
+      for (i = mi->index; i < mi->parent->itemcount - 1; ++i) {
+        mi->parent->items[i] = mi->parent->items[i + 1];
+        mi->parent->items[i]->index = i;
+      }
+      --mi->parent->itemcount;
+    }
+    if (mi->parent->search) {
+      search_dispose(mi->parent->search);
+      mi->parent->search = NULL;
+    }
+  }
+  /* pooled strings belong to the menu's listing */
+  if (mi && !mi->pooled) {
     if (mi->title)
       free(mi->title);
     if (mi->command)
@@ -432,6 +786,18 @@ void animenu_disposeitem(struct animenuitem *mi) {
       free(mi->path);
     if (mi->regex)
       free(mi->regex);
+  }
+  if (mi) {
+    if (mi->icon)
+      free(mi->icon);
+    if (mi->generator)
+      mi->generator->dispose(mi->generator);
+    if (mi->rebuild)
+      animenu_loop->removetimer(animenu_loop, mi->rebuild);
+    if (mi->scanner)
+      mi->scanner->dispose(mi->scanner);
+    if (mi->filter)
+      mi->filter->dispose(mi->filter);
     if (mi->menu)
       mi->menu->dispose(mi->menu);
 
@@ -440,11 +806,28 @@ void animenu_disposeitem(struct animenuitem *mi) {
 }
 
 void animenu_disposemenu(struct animenucontext *menu) {
-  if (menu) {
+  struct animenucontext **interned;
+  if (menu && --menu->refs == 0) {
+    for (interned = &animenu_interned; *interned; interned = &(*interned)->nextinterned) {
+      if (*interned == menu) {
+        *interned = menu->nextinterned;
+        break;
+      }
+    }
     if (menu->osd)
       menu->osd->dispose(menu->osd, menu->menuanimation);
+    /* items are going in bulk, don't maintain the indices */
+    if (menu->items)
+      free(menu->items);
+    menu->items = NULL;
+    search_dispose(menu->search);
+    menu->search = NULL;
     while (menu->firstitem)
       menu->firstitem->dispose(menu->firstitem);
+    if (menu->source)
+      free(menu->source);
+    /* a launch may still be reading the listing */
+    animenu_releaselisting(menu->listing);
     free(menu);
   }
 }
@@ -456,18 +839,22 @@ void animenu_disposemenu(struct animenucontext *menu) {
  if each menu's OSD was built in the animenu_createmenu() call
  the order of generation would be from leaf to root, so the parent
  geometry wouldn't be available
+ shared menus are reached once per parent, but only get the one OSD,
+ which is moved alongside whichever parent opens it
 */
 int animenu_genosd(struct animenucontext *menu) {
   int result = TRUE;
   struct animenuitem *item;
   struct osdcontext *parent = NULL;
+  if (menu->osd)
+    return(TRUE);
   if (menu->parent)
     parent = menu->parent->osd;
   if (!(menu->osd = osd_create(parent, animenu_idcallback, menu->firstitem)))
     return(FALSE);
   item = menu->firstitem;
   while (item) {
-    if (item->type == animenuitem_menu) {
+    if (item->menu) {
       result &= animenu_genosd(item->menu);
     }
     item = item->next;
@@ -475,6 +862,137 @@ int animenu_genosd(struct animenucontext *menu) {
   return(result);
 }
 
+/* close an open chain of sub menus, without animation */
+static void animenu_close(struct animenucontext *menu) {
+  struct animenuitem *item;
+  while (menu && menu->visible) {
+    menu->osd->hide(menu->osd, 0);
+    menu->visible = FALSE;
+    item = menu->currentitem;
+    menu->currentitem = NULL;
+    menu = item ? item->menu : NULL;
+  }
+}
+
+/* put a re-read menu back on screen the way it was. 'selected' is the
+ * old selection, matched to the new items by title, and 'open' says
+ * whether its sub menu was showing */
+static void animenu_restore(struct animenucontext *menu, struct animenuitem *selected,
+                            int open) {
+  struct animenuitem *item;
+  struct animenucontext *submenu;
+
+  menu->osd->show(menu->osd, 0);
+  for (item = selected ? menu->firstitem : NULL; item; item = item->next) {
+    if (item->type == selected->type && item->title && selected->title &&
+        strcmp(item->title, selected->title) == 0)
+      break;
+  }
+  menu->currentitem = item;
+  menu->showcurrent(menu);
+
+  /* a sub menu still on the selected path stays open, lined up against
+   * the new window */
+  if (item && open && item->menu && item->menu->visible) {
+    for (submenu = item->menu; submenu && submenu->visible;
+         submenu = submenu->currentitem ? submenu->currentitem->menu : NULL) {
+      submenu->osd->place(submenu->osd, submenu->parent->osd);
+      submenu->showcurrent(submenu);
+    }
+  } else if (item && open)
+    item->select(item);
+}
+
+/* swap the item lists, the old ones go with 'fresh' */
+static void animenu_swapitems(struct animenucontext *menu, struct animenucontext *fresh) {
+  struct animenuitem *item;
+
+  _swap(struct animenuitem *, menu->firstitem, fresh->firstitem);
+  _swap(struct animenuitem *, menu->lastitem, fresh->lastitem);
+  _swap(struct animenuitem **, menu->items, fresh->items);
+  _swap(int, menu->itemcount, fresh->itemcount);
+  _swap(int, menu->itemsalloc, fresh->itemsalloc);
+  for (item = menu->firstitem; item; item = item->next) {
+    item->parent = menu;
+    if (item->menu)
+      item->menu->parent = menu;
+  }
+  for (item = fresh->firstitem; item; item = item->next)
+    item->parent = fresh;
+  search_dispose(menu->search);
+  menu->search = NULL;
+  menu->currentitem = NULL;
+}
+
+/* give a menu with new items a new osd, and if it was on screen, put
+ * it back as it was. 'selected' is the old selection, and 'open' the
+ * sub menu open from it, if any */
+static void animenu_redisplay(struct animenucontext *menu, struct animenuitem *selected,
+                              struct animenucontext *open) {
+  struct osdcontext *osd;
+
+  osd = menu->osd;
+  menu->osd = NULL;
+  animenu_genosd(menu);
+  if (menu->visible && menu->osd)
+    animenu_restore(menu, selected, open != NULL);
+  else
+    menu->visible = FALSE;
+  /* the sub menu open before may not be on the new path */
+  if (open && (!menu->currentitem || menu->currentitem->menu != open))
+    animenu_close(open);
+  /* the new osd is already mapped over the old one */
+  if (osd)
+    osd->dispose(osd, 0);
+}
+
+/* re-read the menu file at 'path', if it is part of the tree, and swap
+ * the new items and osd into the existing (possibly shared) menu. sub
+ * menus from other files are shared rather than re-read, and on screen
+ * the selection is kept wherever its title still exists. if the file
+ * can't be read, the old menu stays. returns the number of menus
+ * replaced */
+int animenu_reload(const char *path) {
+  struct animenucontext *menu, *fresh, *open;
+  struct animenuitem *selected;
+  struct stat statbuf;
+  char source[PATH_MAX + 1];
+  FILE *f;
+
+  if (stat(path, &statbuf) == -1 || !realpath(path, source))
+    return(0);
+  for (menu = animenu_interned; menu; menu = menu->nextinterned) {
+    if (strcmp(menu->source, source) == 0)
+      break;
+  }
+  if (!menu || !(f = fopen(path, "r")))
+    return(0);
+
+  _tracestart(tracestart);
+  if (!(fresh = animenu_newmenu())) {
+    fclose(f);
+    return(0);
+  }
+  /* an edit saved by renaming over the old file changes its identity */
+  menu->dev = statbuf.st_dev;
+  menu->ino = statbuf.st_ino;
+  fresh->source = menu->source;
+  menu->parsing = TRUE;
+  animenu_parseitems(fresh, f);
+  menu->parsing = FALSE;
+  fclose(f);
+  fresh->source = NULL;
+
+  selected = menu->visible ? menu->currentitem : NULL;
+  open = selected && selected->menu && selected->menu->visible ? selected->menu : NULL;
+
+  animenu_swapitems(menu, fresh);
+  animenu_redisplay(menu, selected, open);
+  fresh->dispose(fresh);
+  _traceend(tracestart, "reload", path);
+  return(1);
+}
+
 void animenu_show(struct animenucontext *menu) {
   if ((menu) && (menu->osd)) {
     if (menu->visible) {
@@ -497,21 +1015,15 @@ void animenu_show(struct animenucontext *menu) {
 }
 
 void animenu_showcurrent(struct animenucontext *menu) {
-  int i = 0;
-  struct animenuitem *item = menu->firstitem;
-  while (item) {
-    if (item == menu->currentitem) {
-      menu->osd->showselected(menu->osd, i);
-      return;
-    }
-    item = item->next;
-    ++i;
-  }
-  menu->osd->showselected(menu->osd, -1);
+  if (menu->osd)
+    menu->osd->showselected(menu->osd, menu->currentitem ? menu->currentitem->index : -1);
 }
 
 void animenu_hide(struct animenucontext *menu) {
   int frame;
+  /* the root going means the whole path is, so keep it for next time */
+  if (!menu->parent && menu->visible)
+    animenu_remember(menu);
   for (frame = 0; frame < OSD_MAXANIMFRAME; frame += 40) {
     animenu_hideframe(menu, frame);
     usleep(menu->menuanimation);
@@ -521,7 +1033,8 @@ void animenu_hide(struct animenucontext *menu) {
 void animenu_hideframe(struct animenucontext *menu, int frame) {
   struct animenuitem *item = menu->firstitem;
   while (item) {
-    if (item->menu != NULL && item->menu->visible)
+    /* a shared menu is only open below the parent that opened it */
+    if (item->menu != NULL && item->menu->visible && item->menu->parent == menu)
       animenu_hideframe(item->menu, frame);
     item = item->next;
   }
@@ -534,6 +1047,56 @@ void animenu_hideframe(struct animenucontext *menu, int frame) {
   }
 }
 
+/* what a launch thread runs, which it frees */
+struct animenulaunch {
+  char *command; /* NULL until made up from the listing */
+  struct browselisting *listing; /* browse menu items */
+  size_t name; /* pool offset of the file to run, 0 for all of them */
+};
+
+static void animenu_freelaunch(struct animenulaunch *launch) {
+  if (launch->command)
+    free(launch->command);
+  animenu_releaselisting(launch->listing);
+  free(launch);
+}
+
+/* a browse menu entry's full path, from its name and the base path
+ * at the start of the pool */
+static char *animenu_itempath(struct animenuitem *mi) {
+  char *path;
+  const char *base = mi->parent->listing->pool->buf;
+  if ((path = malloc(strlen(base) + strlen(mi->path) + 1)))
+    sprintf(path, "%s%s", base, mi->path);
+  return(path);
+}
+
+/* the command line for a browse menu launch, the browse command then
+ * the quoted file path, or every file's for 'play all' */
+static char *animenu_listingcommand(struct animenulaunch *launch) {
+  const struct browselisting *listing = launch->listing;
+  const char *base = listing->pool->buf, *name;
+  size_t size, baselen = strlen(base);
+  char *command, *end;
+  int i;
+
+  size = strlen(base + listing->commandat) + 1;
+  for (i = 0; i < listing->count; ++i) {
+    if (!listing->files[i].dir && (!launch->name || listing->files[i].name == launch->name))
+      size += baselen + strlen(base + listing->files[i].name) + 3;
+  }
+  if (!(command = malloc(size)))
+    return(NULL);
+  end = stpcpy(command, base + listing->commandat);
+  for (i = 0; i < listing->count; ++i) {
+    if (!listing->files[i].dir && (!launch->name || listing->files[i].name == launch->name)) {
+      name = base + listing->files[i].name;
+      end += sprintf(end, " \"%s%s\"", base, name);
+    }
+  }
+  return(command);
+}
+
 void animenu_go(struct animenuitem *mi) {
   /* hide the menu hierarchy */
   struct animenucontext *parent = NULL;
@@ -543,89 +1106,650 @@ void animenu_go(struct animenuitem *mi) {
     parent = parent->parent;
   parent->hide(parent);
 
-  /* execute the item's command */
+  /* execute the item's command. a menu file item's is copied, a browse
+   * item's is put together on the thread from the listing, which a
+   * rescan can't change or free from under it */
+  struct animenulaunch *launch;
   pthread_t thread;
-  pthread_create(&thread, NULL, animenu_thread, mi->command);
+  if (!mi->command || !(launch = calloc(1, sizeof(struct animenulaunch))))
+    return;
+  if (!mi->pooled) {
+    if (!(launch->command = strdup(mi->command))) {
+      free(launch);
+      return;
+    }
+  } else {
+    launch->listing = animenu_reflisting(mi->parent->listing);
+    launch->name = mi->path ? mi->path - launch->listing->pool->buf : 0;
+  }
+  if (pthread_create(&thread, NULL, animenu_thread, launch) == 0)
+    pthread_detach(thread);
+  else
+    animenu_freelaunch(launch);
+}
+
+/* items from an exec menu's program, added as they arrive */
+static void animenu_execitem(void *ud, char **itemcfg) {
+  struct animenuitem *mi = (struct animenuitem *) ud;
+  animenu_parseitem(mi->menu, itemcfg);
+  mi->menu->osdstale = TRUE;
+}
+
+/* swap in an osd covering an exec menu's items so far. the new window
+ * is mapped before the old one goes, so it doesn't flicker */
+static void animenu_rebuildosd(struct animenucontext *menu) {
+  struct animenuitem *placeholder;
+  struct osdcontext *osd;
+
+  menu->osdstale = FALSE;
+  osd = menu->osd;
+  menu->osd = NULL;
+  /* the placeholder goes once there is something real. the old osd
+   * draws from it, so has to go first */
+  if (menu->itemcount > 1 && menu->firstitem->type == animenuitem_null) {
+    placeholder = menu->firstitem;
+    if (menu->currentitem == placeholder)
+      menu->currentitem = placeholder->next;
+    if (osd)
+      osd->dispose(osd, 0);
+    osd = NULL;
+    placeholder->dispose(placeholder);
+  }
+  animenu_genosd(menu);
+  if (menu->visible && menu->osd) {
+    menu->osd->show(menu->osd, 0);
+    menu->showcurrent(menu);
+  }
+  if (osd)
+    osd->dispose(osd, 0);
+}
+
+static void animenu_execrebuild(void *ud);
+
+/* rebuild an exec menu's osd if items have come in. a hidden menu is
+ * left until it is shown or its program is done, and one with a sub
+ * menu open over it until that closes, as the new window would be
+ * mapped above it */
+static void animenu_execflush(struct animenuitem *mi) {
+  struct animenucontext *menu = mi->menu;
+  struct animenuitem *item = menu->currentitem;
+
+  if (!menu->osdstale || (!menu->visible && mi->generator))
+    return;
+  if (menu->visible && item && item->menu && item->menu->visible &&
+      item->menu->parent == menu) {
+    if (!mi->rebuild &&
+        !(mi->rebuild = animenu_loop->addtimer(animenu_loop, animenu_execrebuild, mi)))
+      return;
+    animenu_loop->settimer(animenu_loop, mi->rebuild, ANIMENU_EXECREBUILD);
+    return;
+  }
+  animenu_rebuildosd(menu);
+}
+
+static void animenu_execrebuild(void *ud) {
+  struct animenuitem *mi = (struct animenuitem *) ud;
+  animenu_loop->removetimer(animenu_loop, mi->rebuild);
+  mi->rebuild = NULL;
+  animenu_execflush(mi);
+}
+
+/* reads come in far more often than the osd need be rebuilt, so the
+ * items from those within a short while of each other go in together */
+static void animenu_execbatch(void *ud) {
+  struct animenuitem *mi = (struct animenuitem *) ud;
+
+  if (!mi->menu->osdstale || mi->rebuild)
+    return;
+  if ((mi->rebuild = animenu_loop->addtimer(animenu_loop, animenu_execrebuild, mi)))
+    animenu_loop->settimer(animenu_loop, mi->rebuild, ANIMENU_EXECREBUILD);
+  else
+    animenu_execflush(mi);
+}
+
+static void animenu_execdone(void *ud, int complete) {
+  struct animenuitem *mi = (struct animenuitem *) ud;
+  mi->generator = NULL;
+  /* an incomplete menu is shown, but run again on the next visit */
+  if (!complete)
+    mi->expires = 0;
+  else
+    mi->expires = mi->ttl < 0 ? -1 : loop_now() + mi->ttl;
+  if (mi->rebuild) {
+    animenu_loop->removetimer(animenu_loop, mi->rebuild);
+    mi->rebuild = NULL;
+  }
+  animenu_execflush(mi);
+}
+
+/* a sub menu holding only a placeholder, for an item whose entries are
+ * still to come, in place of any from an earlier visit */
+static struct animenucontext *animenu_placeholder(struct animenuitem *mi) {
+  struct animenucontext *menu;
+  struct animenuitem *placeholder;
+
+  if (!(menu = animenu_newmenu()))
+    return(NULL);
+  if (!(placeholder = animenu_createitem(animenuitem_null, "...", NULL, NULL, NULL, 0))) {
+    menu->dispose(menu);
+    return(NULL);
+  }
+  menu->additem(menu, placeholder);
+  if (mi->menu)
+    mi->menu->dispose(mi->menu);
+  mi->menu = menu;
+  menu->parent = mi->parent;
+  animenu_genosd(menu);
+  return(menu);
+}
+
+/* start the program behind an exec menu, filling a new menu which is
+ * shown straight away, with a placeholder until the first item */
+static void animenu_exec(struct animenuitem *mi) {
+  struct animenu_options* options = get_options();
+
+  if (!animenu_loop) {
+    fprintf(stderr, "cannot run menu program '%s' outside the main loop\n", mi->command);
+    return;
+  }
+  if (!animenu_placeholder(mi))
+    return;
+  mi->expires = 0;
+  /* on failure the placeholder stays, and selecting again retries */
+  mi->generator = generator_create(animenu_loop, mi->command, options->exectimeout,
+                                   animenu_execitem, animenu_execbatch, animenu_execdone, mi);
+}
+
+/* whether a fresh scan has the same entries as the listing shown, so
+ * no menu need be made from it */
+static int animenu_samelisting(const struct browselisting *shown,
+                               const struct browselisting *fresh) {
+  int i;
+  if (!shown || shown->count != fresh->count)
+    return(FALSE);
+  for (i = 0; i < shown->count; ++i) {
+    if (shown->files[i].dir != fresh->files[i].dir ||
+        strcmp(shown->pool->buf + shown->files[i].name,
+               fresh->pool->buf + fresh->files[i].name) != 0)
+      return(FALSE);
+  }
+  return(TRUE);
+}
+
+/* swap a fresh scan's entries into a browse menu. directories already
+ * visited keep their sub menus, and with them any path open below */
+static void animenu_relist(struct animenucontext *menu, struct animenucontext *fresh) {
+  struct animenuitem *selected, *item, *old;
+  struct animenucontext *open;
+
+  selected = menu->visible ? menu->currentitem : NULL;
+  open = selected && selected->menu && selected->menu->visible ? selected->menu : NULL;
+
+  /* the old listing goes with 'fresh', or with the last launch from it */
+  animenu_swapitems(menu, fresh);
+  _swap(struct browselisting *, menu->listing, fresh->listing);
+  for (old = fresh->firstitem; old; old = old->next) {
+    if (!old->menu || old->type != animenuitem_filesystem)
+      continue;
+    for (item = menu->firstitem; item; item = item->next) {
+      if (item->type == old->type && !item->menu && strcmp(item->title, old->title) == 0) {
+        item->menu = old->menu;
+        item->menu->parent = menu;
+        old->menu = NULL;
+        break;
+      }
+    }
+  }
+  animenu_redisplay(menu, selected, open);
+  fresh->dispose(fresh);
+}
+
+/* a browse item's scan is done. the first listing becomes its sub
+ * menu, later ones replace its entries if they have changed. on
+ * failure whatever was shown stays, still marked as stale */
+static void animenu_browsedone(void *ud, struct browselisting *listing) {
+  struct animenuitem *mi = (struct animenuitem *) ud;
+  struct animenucontext *menu, *fresh;
+
+  mi->scanner = NULL;
+  if (mi->speculated == -1)
+    mi->speculated = listing ? loop_now() : 0;
+  if (listing && (menu = mi->menu) && animenu_samelisting(menu->listing, listing)) {
+    animenu_releaselisting(listing);
+    if (menu->osd)
+      menu->osd->setstale(menu->osd, FALSE);
+    return;
+  }
+  if (!listing || !(fresh = animenu_listmenu(listing))) {
+    if (!mi->menu)
+      fprintf(stderr, "cannot create filesystem menu\n");
+    return;
+  }
+  _tracestart(tracestart);
+  if (!(menu = mi->menu)) {
+    mi->menu = fresh;
+    mi->osddata.title = mi->title;
+    fresh->parent = mi->parent;
+    /* generate osd frames */
+    animenu_genosd(fresh);
+  } else {
+    animenu_relist(menu, fresh);
+    /* the menu being navigated may have gone with the old entries */
+    if (animenu_refresh)
+      animenu_refresh();
+  }
+  _traceend(tracestart, "relist", NULL);
+}
+
+/* scan a browse item's directory, unless a scan is already going. a
+ * quick scan is waited for if 'grace', a slow one is left to catch up
+ * through the main loop. without a loop the scan runs here */
+static void animenu_rescan(struct animenuitem *mi, int grace) {
+  struct animenu_options* options = get_options();
+  struct filtercontext *filter = mi->filter;
+  char *path;
+
+  if (mi->scanner) {
+    if (grace)
+      mi->scanner->wait(mi->scanner, ANIMENU_SCANGRACE);
+    return;
+  }
+  /* entries of a browse menu share its pattern */
+  if (!filter && mi->parent->listing)
+    filter = mi->parent->listing->filter;
+  path = mi->pooled ? animenu_itempath(mi) : NULL;
+  if (!animenu_loop)
+    animenu_browsedone(mi, animenu_scandir(path, mi->regex, filter, mi->command, mi->recurse));
+  else if ((mi->scanner = scanner_create(animenu_loop, path, mi->regex, filter, mi->command,
+                                         mi->recurse, options->scantimeout,
+                                         animenu_browsedone, mi)) && grace)
+    mi->scanner->wait(mi->scanner, ANIMENU_SCANGRACE);
+  if (path)
+    free(path);
+}
+
+/* whether a browse item's listing came from a speculative scan, recent
+ * enough to show as it is */
+static int animenu_fresh(struct animenuitem *mi) {
+  return(mi->menu && mi->menu->listing && mi->speculated > 0 &&
+         loop_now() - mi->speculated < ANIMENU_SCANFRESH);
+}
+
+/* a browse item's sub menu, ready to show. an earlier listing is served
+ * while a fresh scan runs, and a placeholder if there isn't one yet.
+ * either is marked stale until the scan is in */
+static struct animenucontext *animenu_browse(struct animenuitem *mi) {
+  if (!animenu_fresh(mi))
+    animenu_rescan(mi, TRUE);
+  /* a visit rescans as usual after this */
+  mi->speculated = 0;
+  if (!mi->menu && mi->scanner)
+    animenu_placeholder(mi);
+  if (mi->menu && mi->menu->osd)
+    mi->menu->osd->setstale(mi->menu->osd, mi->scanner != NULL);
+  return(mi->menu);
+}
+
+/* the selection has rested on 'mi', so get its sub menu ready in the
+ * background in case it is opened next. a browse item is scanned and
+ * its menu and osd built as the listing comes in. if the selection
+ * moves on the menu is kept, as for a visit. menu file sub menus are
+ * built with the tree already, and an exec menu's program isn't run
+ * on spec */
+void animenu_speculate(struct animenuitem *mi) {
+  if (animenu_loop && mi->type == animenuitem_filesystem && !mi->scanner && !animenu_fresh(mi)) {
+    mi->speculated = -1;
+    animenu_rescan(mi, FALSE);
+    if (!mi->scanner && mi->speculated == -1)
+      mi->speculated = 0;
+  }
+}
+
+/* add a browse item's base directory to 'paths', once */
+static void animenu_addbase(struct animenuitem *mi, char ***paths, int *count, int *alloc) {
+  char **grown, *base;
+  int i;
+
+  if (!mi->regex || *mi->regex != '/' || !(base = animenu_basepath(mi->regex)))
+    return;
+  for (i = 0; i < *count; ++i) {
+    if (strcmp((*paths)[i], base) == 0) {
+      free(base);
+      return;
+    }
+  }
+  if (*count == *alloc) {
+    if (!(grown = realloc(*paths, (*alloc ? *alloc * 2 : 8) * sizeof(char *)))) {
+      free(base);
+      return;
+    }
+    *paths = grown;
+    *alloc = *alloc ? *alloc * 2 : 8;
+  }
+  (*paths)[(*count)++] = base;
+}
+
+static void animenu_findbases(struct animenucontext *menu, char ***paths, int *count, int *alloc) {
+  struct animenuitem *item;
+  if (menu->visited == animenu_generation)
+    return;
+  menu->visited = animenu_generation;
+  for (item = menu->firstitem; item; item = item->next) {
+    if (item->type == animenuitem_filesystem && !item->pooled)
+      animenu_addbase(item, paths, count, alloc);
+    else if ((item->type == animenuitem_menu || item->type == animenuitem_exec) && item->menu)
+      animenu_findbases(item->menu, paths, count, alloc);
+  }
+}
+
+/* the directories the browse items in the menus start from, for
+ * walking ahead of a visit. caller must free the array and strings */
+int animenu_browsebases(struct animenucontext *root, char ***paths) {
+  int count = 0, alloc = 0;
+  *paths = NULL;
+  ++animenu_generation;
+  animenu_findbases(root, paths, &count, &alloc);
+  return(count);
+}
+
+static void animenu_revalidatemenu(struct animenucontext *menu) {
+  struct animenuitem *item;
+  if (menu->visited == animenu_generation)
+    return;
+  menu->visited = animenu_generation;
+  for (item = menu->firstitem; item; item = item->next) {
+    if (!item->menu)
+      continue;
+    if (item->type == animenuitem_filesystem && item->menu->listing && !item->menu->visible)
+      animenu_rescan(item, FALSE);
+    animenu_revalidatemenu(item->menu);
+  }
+}
+
+/* rescan the browse menus already visited, so they are up to date
+ * when next shown. open ones are left to be rescanned on a visit */
+void animenu_revalidate(struct animenucontext *root) {
+  ++animenu_generation;
+  animenu_revalidatemenu(root);
 }
 
 void animenu_select(struct animenuitem *mi) {
-  if (mi->type == animenuitem_menu) {
+  /* exec menus are kept until their time to live is up */
+  if (mi->type == animenuitem_exec && !mi->generator &&
+      (!mi->menu || mi->expires == 0 || (mi->expires > 0 && loop_now() >= mi->expires)))
+    animenu_exec(mi);
+
+  if ((mi->type == animenuitem_menu || mi->type == animenuitem_exec) && mi->menu) {
+    /* a shared menu opens alongside whichever parent it's reached from */
+    mi->menu->parent = mi->parent;
+    /* items an exec menu's program sent while it was hidden */
+    if (mi->menu->osdstale)
+      animenu_rebuildosd(mi->menu);
+    if (mi->menu->osd)
+      mi->menu->osd->place(mi->menu->osd, mi->parent->osd);
+    mi->menu->currentitem = mi->menu->firstitem;
+    mi->menu->show(mi->menu);
+    animenu_showcurrent(mi->menu);
+  } else if (mi->type == animenuitem_filesystem && animenu_browse(mi)) {
+    /* select menu */
+    if (mi->menu->osd)
+      mi->menu->osd->place(mi->menu->osd, mi->parent->osd);
     mi->menu->currentitem = mi->menu->firstitem;
     mi->menu->show(mi->menu);
     animenu_showcurrent(mi->menu);
-  } else if (mi->type == animenuitem_filesystem) {
-    /* create dynamic filesystem item content */
-    struct animenucontext *menu;
-    if ((menu = animenu_createfilesystem(mi->path, mi->regex, mi->command, mi->recurse))) {
-      /* attach new sub menu */
-      mi->menu = menu;
-      mi->osddata.title = mi->title;
-      menu->parent = mi->parent;
-      /* generate osd frames */
-      animenu_genosd(menu);
-      /* select menu */
-      mi->menu->currentitem = mi->menu->firstitem;
-      mi->menu->show(mi->menu);
-      animenu_showcurrent(mi->menu);
-    } else {
-      fprintf(stderr, "cannot create filesystem menu\n");
-    }
   }
 }
 
+/* the path open when the menu was last hidden, as the index and title
+ * of the selected item in each menu from the root down. titles are
+ * matched first, so a path survives items being added or removed */
+#define ANIMENU_MAXDEPTH 32
+
+struct animenuresume {
+  int index;
+  char *title;
+};
+
+static struct animenuresume animenu_resumepath[ANIMENU_MAXDEPTH];
+static int animenu_resumedepth = 0;
+
+static void animenu_forget() {
+  while (animenu_resumedepth > 0)
+    free(animenu_resumepath[--animenu_resumedepth].title);
+}
+
+static void animenu_resumeadd(int index, const char *title) {
+  struct animenuresume *level = &animenu_resumepath[animenu_resumedepth];
+  if (animenu_resumedepth == ANIMENU_MAXDEPTH || !(level->title = strdup(title ? title : "")))
+    return;
+  level->index = index;
+  ++animenu_resumedepth;
+}
+
+/* written whole to a temporary file then renamed over the old one, so
+ * a crash can't leave it half written */
+static void animenu_savestate(const char *path) {
+  char tmp[PATH_MAX];
+  FILE *f;
+  int i;
+
+  snprintf(tmp, PATH_MAX, "%s.tmp", path);
+  if (!(f = fopen(tmp, "w"))) {
+    fprintf(stderr, "cannot write state file '%s'\n", tmp);
+    return;
+  }
+  fprintf(f, "# animenu state, the selected item in each open menu\n");
+  for (i = 0; i < animenu_resumedepth; ++i)
+    fprintf(f, "%d\t%s\n", animenu_resumepath[i].index, animenu_resumepath[i].title);
+  if (fclose(f) != 0 || rename(tmp, path) == -1) {
+    fprintf(stderr, "cannot write state file '%s'\n", path);
+    unlink(tmp);
+  }
+}
+
+void animenu_loadstate(const char *path) {
+  char line[BUFSIZE + 1], *title, *end;
+  int index;
+  FILE *f;
+
+  if (!(f = fopen(path, "r")))
+    return;
+  animenu_forget();
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#')
+      continue;
+    if ((end = strchr(line, '\n')))
+      *end = '\0';
+    index = strtol(line, &title, 10);
+    if (title == line || *title != '\t' || index < 0)
+      break;
+    animenu_resumeadd(index, title + 1);
+  }
+  fclose(f);
+}
+
+void animenu_remember(struct animenucontext *root) {
+  struct animenu_options* options = get_options();
+  struct animenucontext *menu = root;
+  struct animenuitem *item;
+
+  animenu_forget();
+  while (menu && menu->visible && (item = menu->currentitem)) {
+    animenu_resumeadd(item->index, item->title);
+    menu = item->menu;
+  }
+  if (options->statefile[0])
+    animenu_savestate(options->statefile);
+}
+
+static struct animenuitem *animenu_resumeitem(struct animenucontext *menu,
+                                              struct animenuresume *level) {
+  int i;
+  if (level->index < menu->itemcount && menu->items[level->index]->title &&
+      strcmp(menu->items[level->index]->title, level->title) == 0)
+    return(menu->items[level->index]);
+  for (i = 0; i < menu->itemcount; ++i) {
+    if (menu->items[i]->title && strcmp(menu->items[i]->title, level->title) == 0)
+      return(menu->items[i]);
+  }
+  return(level->index < menu->itemcount ? menu->items[level->index] : NULL);
+}
+
+/* the sub menu an item would open, ready to show. menus already built
+ * are taken as they are, and browse menus from the last visit are
+ * shown while they are rescanned. exec menus past their time to live,
+ * or still being read, end the path */
+static struct animenucontext *animenu_resumemenu(struct animenuitem *mi) {
+  struct animenucontext *menu = NULL;
+  if (mi->type == animenuitem_menu ||
+      (mi->type == animenuitem_exec && !mi->generator && mi->expires != 0 &&
+       (mi->expires < 0 || loop_now() < mi->expires)))
+    menu = mi->menu;
+  else if (mi->type == animenuitem_filesystem)
+    menu = animenu_browse(mi);
+  if (menu && menu->osd) {
+    menu->parent = mi->parent;
+    menu->osd->place(menu->osd, mi->parent->osd);
+    return(menu);
+  }
+  return(NULL);
+}
+
+/* show the root with the remembered path open again, every menu on it
+ * sliding in together. returns the deepest menu opened, or NULL if
+ * there was no path to follow */
+struct animenucontext *animenu_resume(struct animenucontext *root) {
+  struct animenucontext *path[ANIMENU_MAXDEPTH], *menu = root;
+  struct animenuitem *item;
+  int depth = 0, level, frame;
+
+  if (animenu_resumedepth == 0 || !root->osd || root->visible)
+    return(NULL);
+  _tracestart(tracestart);
+  for (level = 0; level < animenu_resumedepth && menu; ++level) {
+    item = animenu_resumeitem(menu, &animenu_resumepath[level]);
+    menu->currentitem = item;
+    menu->visible = TRUE;
+    path[depth++] = menu;
+    if (!item || level == animenu_resumedepth - 1)
+      break;
+    menu = animenu_resumemenu(item);
+  }
+  for (frame = 0; frame < OSD_MAXANIMFRAME; frame += 30) {
+    for (level = 0; level < depth; ++level)
+      path[level]->osd->showframe(path[level]->osd, frame);
+    usleep(root->menuanimation);
+  }
+  for (level = 0; level < depth; ++level)
+    animenu_showcurrent(path[level]);
+  _traceend(tracestart, "resume", NULL);
+  return(path[depth - 1]);
+}
+
 void animenu_prev(struct animenucontext *menu) {
+  animenu_move(menu, -1);
+}
+
+void animenu_next(struct animenucontext *menu) {
+  animenu_move(menu, 1);
+}
+
+/* step 'delta' items forward (or back if negative) through the deepest
+ * visible menu, repainting only the final selection. stepping cycles
+ * through the unselected position past either end */
+void animenu_move(struct animenucontext *menu, int delta) {
   struct animenuitem *item;
-  int done = FALSE;
+  int pos, count;
   if (!(menu->visible)) {
     menu->show(menu);
   }
 
-  while (!(done)) {
-    if ((item = menu->currentitem)) {
-      if ((item->type == animenuitem_menu) && (item->menu->visible)) {
-        menu = item->menu;
-        item = menu->currentitem;
-      } else {
-        menu->currentitem = item->prev;
-        animenu_showcurrent(menu);
-        done = TRUE;
-      }
-    } else {
-      menu->currentitem = menu->lastitem;
-      animenu_showcurrent(menu);
-      done = TRUE;
-    }
-  }
+  while ((item = menu->currentitem) &&
+         (item->type == animenuitem_menu) && (item->menu->visible))
+    menu = item->menu;
+
+  if ((count = menu->itemcount) == 0)
+    return;
+  /* 'count' stands for no selection */
+  pos = menu->currentitem ? menu->currentitem->index : count;
+  pos = ((pos + delta) % (count + 1) + count + 1) % (count + 1);
+  menu->currentitem = pos < count ? menu->items[pos] : NULL;
+  animenu_showcurrent(menu);
 }
 
-void animenu_next(struct animenucontext *menu) {
+/* select an item directly by index, negative indices count back from
+ * the end of the menu */
+void animenu_seek(struct animenucontext *menu, int index) {
   struct animenuitem *item;
-  int done = FALSE;
   if (!(menu->visible)) {
     menu->show(menu);
   }
 
-  while (!(done)) {
-    if ((item = menu->currentitem)) {
-      if ((item->type == animenuitem_menu) && (item->menu->visible)) {
-        menu = item->menu;
-        item = menu->currentitem;
-      } else {
-        menu->currentitem = item->next;
-        animenu_showcurrent(menu);
-        done = TRUE;
-      }
-    } else {
-      menu->currentitem = menu->firstitem;
-      animenu_showcurrent(menu);
-      done = TRUE;
+  while ((item = menu->currentitem) &&
+         (item->type == animenuitem_menu) && (item->menu->visible))
+    menu = item->menu;
+
+  if (menu->itemcount == 0)
+    return;
+  if (index < 0)
+    index += menu->itemcount;
+  if (index < 0)
+    index = 0;
+  else if (index >= menu->itemcount)
+    index = menu->itemcount - 1;
+  menu->currentitem = menu->items[index];
+  animenu_showcurrent(menu);
+}
+
+/* select the first item whose title starts with 'prefix', in typed
+ * or keypad digit form. the prefix index is built on first use and
+ * dropped whenever the menu's items change */
+int animenu_jump(struct animenucontext *menu, const char *prefix, int t9) {
+  struct animenuitem *item;
+  const char **titles;
+  char *key;
+  int i, index;
+
+  while ((item = menu->currentitem) &&
+         (item->type == animenuitem_menu) && (item->menu->visible))
+    menu = item->menu;
+
+  if (!menu->search) {
+    if (!(titles = malloc(_max(menu->itemcount, 1) * sizeof(char *))))
+      return(FALSE);
+    for (i = 0; i < menu->itemcount; ++i) {
+      item = menu->items[i];
+      /* the 'play all' entry isn't something to jump to */
+      titles[i] = item->title && item->title != playall &&
+                  strcmp(item->title, playall) != 0 ? item->title : NULL;
     }
+    menu->search = search_create(titles, menu->itemcount);
+    free(titles);
+    if (!menu->search)
+      return(FALSE);
   }
+
+  if (!(key = malloc(strlen(prefix) + 1)))
+    return(FALSE);
+  search_normalise(key, prefix, strlen(prefix) + 1, t9);
+  index = search_find(menu->search, key, t9);
+  free(key);
+  if (index == -1)
+    return(FALSE);
+  menu->seek(menu, index);
+  return(TRUE);
 }
 
 void *animenu_thread(void *ud) {
-  char *cmd = (char *) ud;
-  system(cmd);
+  struct animenulaunch *launch = (struct animenulaunch *) ud;
+  _tracestart(tracestart);
+  if (!launch->command)
+    launch->command = animenu_listingcommand(launch);
+  if (launch->command) {
+    system(launch->command);
+    _traceend(tracestart, "launch", launch->command);
+  }
+  animenu_freelaunch(launch);
   return(NULL);
 }
 
@@ -646,110 +1770,111 @@ char *animenu_stripwhitespace(char *str) {
   return str;
 }
 
-/* read a structure with controlled by whitespace/indentation */
-int animenu_readmenufile(FILE *f, char ***item) {
-
-  /* append valid lines to a dynamic buff buffer, determining the
-   * max length and number of lines for the current config item.
-   * allocate memory and then split when hitting the next item or eof
-   * caller must free the memory allocation, and can use _freecfg
-   */
-
-  int i;
-  int idx = 0; /* item index */
-  int maxlen = 0; /* max length seen */
-  int maxlenline = BUFSIZE + 1; /* max line length */
-  int len;
-  char s[maxlenline];
-  char *s2;
-  char *b = malloc(maxlenline); /* flattened item buffer */
-  const char* rx_comment = "^\\s*#.*";
-  const char* rx_empty = "^\\s*$";
-  const char* rx_nested = "^\\s+.*";
-
+/* build the item array handed out by the readers below. there are
+ * always at least three lines, missing ones are empty, and the array
+ * ends with a NULL. caller must free the memory allocation, and can use
+ * _freecfg */
+static void animenu_readeritem(struct menureader *reader, char ***item) {
   struct animenu_options* options = get_options();
+  int i, rows = _max(reader->lines, 3);
+  char *line, *n;
 
-  /* read item to buffer*/
-  b[0] = '\0';
-  do {
-    s[0] = '\0';
-    if (!(fgets(s, maxlenline - 1, f))) {
-      /* eof */
-      if (idx > 0)
-        /* process final item */
-        break;
-      else {
-        /* nothing left to read */
-        free(b);
-        return(FALSE);
-      }
-    }
-    if (rx_compare(s, rx_empty) == 0 ||
-        rx_compare(s, rx_comment) == 0)
-      continue;
-    if (rx_compare(s, rx_nested) != 0) {
-      if (idx > 0) {
-        fseek(f, -strlen(s), SEEK_CUR);
-        break;
-      }
-    }
-    s2 = animenu_stripwhitespace(s);
-    len = strlen(s2);
-    maxlen = _max(len, maxlen);
-    if (idx == 0) {
-      /* force lower case 'type' */
-      for (i = 0; b[i]; i++)
-        b[i] = tolower(b[i]);
-    }
-    if (strlen(s) + len + 1 > sizeof(s)) {
-      /* enlarge buffer */
-      char *b2 = strdup(b);
-      b = realloc(b, sizeof(b) + maxlenline);
-      strcpy(b, b2);
-      free(b2);
-    }
-    sprintf(b + strlen(b), "%s\n", s2);
-    idx++;
-  } while (1);
-
-  /* create item from flat buffer */
-  (*item) = malloc(idx * sizeof(char*));
-  (*item)[0] = malloc(idx * (maxlen + 1) * sizeof(char));
-  int pos = 0;
-  char *n = NULL;
+  (*item) = malloc((rows + 1) * sizeof(char*));
+  (*item)[0] = malloc(rows * (reader->maxlen + 1) * sizeof(char));
   if (options->debug > 0)
     fprintf(stderr, "parsed config item:\n");
-  for (i = 0; pos < strlen(b); i++) {
-    (*item)[i] = (*item)[0] + i * (maxlen + 1);
-    n = strchr(b + pos, '\n');
-    _strncpy((*item)[i], b + pos, n - (b + pos) + 1);
-    pos += n - (b + pos) + 1;
+  for (i = 0, line = reader->buf; i < rows; i++) {
+    (*item)[i] = (*item)[0] + i * (reader->maxlen + 1);
+    if (i < reader->lines) {
+      n = strchr(line, '\n');
+      _strncpy((*item)[i], line, n - line + 1);
+      line = n + 1;
+    } else
+      (*item)[i][0] = '\0';
     if (options->debug > 0)
       fprintf(stderr, "[%d] %s\n", i, (*item)[i]);
   }
-  free(b);
+  (*item)[rows] = NULL;
+  reader->len = reader->lines = reader->maxlen = 0;
+}
+
+/* feed a menu file to the parser a line at a time, as it arrives.
+ * lines of an item after the first are indented, so an item is only
+ * complete when the next one starts, or with a NULL line at the end of
+ * the input. returns TRUE with the completed item in '*item' */
+int animenu_readmenuline(struct menureader *reader, const char *line, char ***item) {
+  char s[BUFSIZE + 1];
+  char *s2, *b;
+  int len, complete = FALSE;
+
+  if (!line) {
+    if (reader->lines == 0)
+      return(FALSE);
+    animenu_readeritem(reader, item);
+    return(TRUE);
+  }
 
-  return(TRUE);
+  /* skip empty lines and comments */
+  for (s2 = (char *) line; isspace(*s2); ++s2)
+    ;
+  if (!*s2 || *s2 == '#')
+    return(FALSE);
+  /* an unindented line starts an item */
+  if (!isspace(*line) && reader->lines > 0) {
+    animenu_readeritem(reader, item);
+    complete = TRUE;
+  }
+
+  _strncpy(s, line, BUFSIZE + 1);
+  s2 = animenu_stripwhitespace(s);
+  len = strlen(s2);
+  if (reader->len + len + 2 > reader->size) {
+    /* enlarge buffer */
+    if (!(b = realloc(reader->buf, reader->size + len + BUFSIZE + 2)))
+      return(complete);
+    reader->buf = b;
+    reader->size += len + BUFSIZE + 2;
+  }
+  sprintf(reader->buf + reader->len, "%s\n", s2);
+  reader->len += len + 1;
+  reader->maxlen = _max(len, reader->maxlen);
+  reader->lines++;
+
+  return(complete);
 }
 
-int rx_compare(const char *s1, const char *s2) {
-  regex_t *usrflt_regex = NULL;
-  int regex_errcode = REG_NOMATCH;
+void animenu_readmenudone(struct menureader *reader) {
+  if (reader->buf)
+    free(reader->buf);
+  memset(reader, 0, sizeof(struct menureader));
+}
 
-  if ((s1) && (s2) && (usrflt_regex = (regex_t *) malloc(sizeof(regex_t))) &&
-      !regcomp(usrflt_regex, s2, REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
-    regex_errcode = regexec(usrflt_regex, s1, 0, NULL, 0);
+/* read a structure with controlled by whitespace/indentation */
+int animenu_readmenufile(FILE *f, char ***item) {
+  struct menureader reader;
+  char s[BUFSIZE + 1];
+  int result = FALSE;
+
+  memset(&reader, 0, sizeof(struct menureader));
+  while (fgets(s, sizeof(s), f)) {
+    if ((result = animenu_readmenuline(&reader, s, item))) {
+      /* the line starts the next item, so leave it for the next call */
+      fseek(f, -strlen(s), SEEK_CUR);
+      break;
+    }
   }
+  if (!result)
+    /* eof */
+    result = animenu_readmenuline(&reader, NULL, item);
+  animenu_readmenudone(&reader);
 
-  if (usrflt_regex)
-    free(usrflt_regex);
-  return regex_errcode;
+  return(result);
 }
 
 char *rx_start(char *s, char **first) {
   char *s2, *m, *m2;
   char rx[] = "*.[]()|^$?+";
-  char rxc[2];
+  char rxc[3];
   s2 = strdup(s);
   int l = 0;
   while (l < strlen(rx) - 1) {
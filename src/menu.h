@@ -12,15 +12,24 @@
 #ifndef ANIMENU_MENU_H
 #define ANIMENU_MENU_H
 
+#include <stdio.h>
+#include <sys/types.h>
+
 #ifndef ANIMENU_H
 #include "animenu.h"
 #endif
 #include "osd.h"
+#include "search.h"
+#include "loop.h"
+#include "generator.h"
+#include "scanner.h"
+#include "filter.h"
 
 /* globals */
 const char *playall;
 
-enum animenuitem_type {animenuitem_null, animenuitem_command, animenuitem_menu, animenuitem_filesystem};
+enum animenuitem_type {animenuitem_null, animenuitem_command, animenuitem_menu, animenuitem_filesystem,
+                       animenuitem_exec};
 
 struct animenuitem {
   /* public functions */
@@ -30,21 +39,40 @@ struct animenuitem {
   /* private data follows */
   struct animenuitem *next, *prev;
   struct animenucontext *parent;
+  int index;
   enum animenuitem_type type;
   char *title;
   char *path;
   char *regex;
   char *command;
+  char *icon;
   int recurse;
+  int pooled; /* strings point into the parent menu's pool */
+  int ttl; /* msecs an exec menu is kept, -1 for ever */
+  long expires;
+  long speculated; /* when a speculative scan came in, -1 while it runs */
+  struct generatorcontext *generator; /* while an exec menu is being read */
+  struct looptimer *rebuild; /* while an exec menu's osd waits to be rebuilt */
+  struct scannercontext *scanner; /* while a browse menu is being read */
+  struct filtercontext *filter; /* browse items from a menu file */
   struct animenucontext *menu;
   struct osditemdata osddata;
 };
 
+/* strings packed end to end, for the results of a directory scan */
+struct stringpool {
+  char *buf;
+  size_t len, size;
+};
+
 struct animenucontext {
   /* public functions */
   void (*dispose) (struct animenucontext *menu);
   void (*next) (struct animenucontext *menu);
   void (*prev) (struct animenucontext *menu);
+  void (*move) (struct animenucontext *menu, int delta);
+  void (*seek) (struct animenucontext *menu, int index);
+  int (*jump) (struct animenucontext *menu, const char *prefix, int t9);
   void (*show) (struct animenucontext *menu);
   void (*showcurrent) (struct animenucontext *menu);
   void (*hide) (struct animenucontext *menu);
@@ -52,13 +80,72 @@ struct animenucontext {
   /* private data */
   struct animenuitem *firstitem, *lastitem;
   struct animenuitem *currentitem;
-  struct animenucontext *parent;
+  struct animenuitem **items; /* indexed view of the item list */
+  int itemcount, itemsalloc;
+  struct searchindex *search; /* built on first jump */
+  struct animenucontext *parent; /* the menu it was last opened from */
+  char *source; /* the menu file this was read from, as a real path */
+  dev_t dev; /* identity of the menu file, for sharing */
+  ino_t ino;
+  struct animenucontext *nextinterned;
+  int refs;
+  int parsing, visited; /* for finding loops between menu files */
   struct osdcontext *osd;
   int menuanimation;
   int visible;
+  int osdstale; /* items added since the osd was built */
+  struct browselisting *listing; /* browse menus, the scan their items point into */
+};
+
+/* the result of a browse scan. the names are packed into 'pool' as
+ * they will be for the menu made from it. a listing isn't changed once
+ * made, a rescan makes another, so one can be read from any thread
+ * holding a reference. the last animenu_releaselisting frees it */
+struct browselisting {
+  int refs;
+  struct stringpool *pool; /* the base path, regex and command, then the names */
+  struct filtercontext *filter; /* shared with sub menus' scans */
+  size_t regexat, commandat; /* pool offsets */
+  struct browsefile {
+    size_t name; /* pool offset, including the leading '/' */
+    int dir;
+  } *files;
+  int count, entries;
+  int recurse;
+};
+
+/* state for reading menu file format a line at a time */
+struct menureader {
+  char *buf; /* lines of the current item, newline terminated */
+  int len, size;
+  int lines, maxlen;
 };
 
 int animenu_initialise(struct animenucontext **rootmenu, const char *filename);
 void animenu_dump(struct animenucontext *menu);
+struct animenucontext *animenu_createmenu(const char *path);
+struct animenucontext *animenu_buildtree(const char *path);
+void animenu_menupath(char *path, const char *name);
+struct browselisting *animenu_scandir(const char *path, const char *regex,
+                                      struct filtercontext *filter,
+                                      const char *command, int recurse);
+struct animenucontext *animenu_listmenu(struct browselisting *listing);
+struct browselisting *animenu_reflisting(struct browselisting *listing);
+void animenu_releaselisting(struct browselisting *listing);
+struct animenucontext *animenu_createfilesystem(char *path, char *regex,
+                                                struct filtercontext *filter,
+                                                char *command, int recurse);
+int animenu_genosd(struct animenucontext *menu);
+int animenu_reload(const char *path);
+struct animenucontext *animenu_resume(struct animenucontext *root);
+int animenu_browsebases(struct animenucontext *root, char ***paths);
+void animenu_revalidate(struct animenucontext *root);
+void animenu_speculate(struct animenuitem *mi);
+void animenu_loadstate(const char *path);
+int animenu_readmenufile(FILE *f, char ***item);
+int animenu_readmenuline(struct menureader *reader, const char *line, char ***item);
+void animenu_readmenudone(struct menureader *reader);
+void animenu_setloop(struct loopcontext *loop);
+void animenu_setrefresh(void (*refresh) ());
 
 #endif
@@ -31,9 +31,26 @@ void makefontspec() {
            options.fontname, options.fontsize);
 }
 
+/* fractional seconds, eg. '2.5', to milliseconds */
+int seconds_to_msecs(const char *val) {
+  return((int)(atof(val) * 1000 + 0.5));
+}
+
+/* 'page[,tenth]' repeat counts at which held buttons speed up */
+void set_acceleration(const char *val) {
+  options.accelpage = options.accelpercent = 0;
+  sscanf(val, "%u,%u", &options.accelpage, &options.accelpercent);
+}
+
+/* paths keep their case, so take them from the line as it was read
+ * rather than the lowercased copy 'val' points into */
+void set_path(char *path, const char *raw, const char *buf, const char *val) {
+  _strncpy(path, raw + (val - buf), strlen(val) + 1);
+}
+
 int read_config() {
 
-  char buf[BUFSIZE + 1];
+  char buf[BUFSIZE + 1], raw[BUFSIZE + 1];
   char *tmp, *key, *val;
   int len, pos, i;
   FILE *f;
@@ -47,6 +64,7 @@ int read_config() {
 
   while (fgets(buf, sizeof(buf), f) != NULL) {
     len = strlen(buf);
+    memcpy(raw, buf, len + 1);
     for (i = 0; i < len; i++)
       buf[i] = tolower(buf[i]);
 
@@ -85,6 +103,28 @@ int read_config() {
         strcpy(options.fgcolour, val);
       } else if (strcmp(key, "fgcoloursel") == 0) {
         strcpy(options.fgcoloursel, val);
+      } else if (strcmp(key, "menutimeout") == 0) {
+        options.menutimeout = seconds_to_msecs(val);
+      } else if (strcmp(key, "exectimeout") == 0) {
+        options.exectimeout = seconds_to_msecs(val);
+      } else if (strcmp(key, "scantimeout") == 0) {
+        options.scantimeout = seconds_to_msecs(val);
+      } else if (strcmp(key, "prewarm") == 0) {
+        options.prewarm = seconds_to_msecs(val);
+      } else if (strcmp(key, "prewarmdepth") == 0) {
+        options.prewarmdepth = atoi(val);
+      } else if (strcmp(key, "pixmapbudget") == 0) {
+        options.pixmapbudget = atoi(val);
+      } else if (strcmp(key, "icondir") == 0) {
+        set_path(options.icondir, raw, buf, val);
+      } else if (strcmp(key, "statefile") == 0) {
+        set_path(options.statefile, raw, buf, val);
+      } else if (strcmp(key, "controlsocket") == 0) {
+        set_path(options.controlsocket, raw, buf, val);
+      } else if (strcmp(key, "pagesize") == 0) {
+        options.pagesize = atoi(val);
+      } else if (strcmp(key, "acceleration") == 0) {
+        set_acceleration(val);
       }
     }
   }
@@ -106,8 +146,20 @@ int process_options(int argc, char *argv[]) {
   strcpy(options.fgcolour, "rgb:88/88/88");
   strcpy(options.fgcoloursel, "white");
   sprintf(options.lircrcfile, "%s/.lircrc", getenv("HOME"));
-  options.menutimeout = 5;
+  options.controlsocket[0] = '\0';
+  options.tracefile[0] = '\0';
+  options.icondir[0] = '\0';
+  options.statefile[0] = '\0';
+  options.menutimeout = 5000;
   options.menuanimation = 1000;
+  options.exectimeout = 10000;
+  options.scantimeout = 10000;
+  options.prewarm = 0;
+  options.prewarmdepth = 2;
+  options.pixmapbudget = 8192;
+  options.pagesize = 10;
+  options.accelpage = 10;
+  options.accelpercent = 30;
   options.daemonise = 0;
   options.dump = 0;
   options.debug = 0;
@@ -130,11 +182,22 @@ int process_options(int argc, char *argv[]) {
       {"fgcoloursel", required_argument, NULL,'s'},
       {"menutimeout", required_argument, NULL, 't'},
       {"menuanimation", required_argument, NULL, 'a'},
+      {"exectimeout", required_argument, NULL, 'E'},
+      {"scantimeout", required_argument, NULL, 'W'},
+      {"prewarm", required_argument, NULL, 'w'},
+      {"prewarmdepth", required_argument, NULL, 'y'},
+      {"pixmapbudget", required_argument, NULL, 'P'},
+      {"pagesize", required_argument, NULL, 'p'},
+      {"icondir", required_argument, NULL, 'I'},
+      {"statefile", required_argument, NULL, 'R'},
+      {"acceleration", required_argument, NULL, 'A'},
+      {"socket", required_argument, NULL, 'S'},
       {"dump", no_argument, NULL, 'M'},
       {"debug", optional_argument, NULL, 'D'},
+      {"trace", required_argument, NULL, 'T'},
       {0, 0, 0, 0}
     };
-    c = getopt_long(argc, argv, "hvdf:n:z:b:c:s:t:a:M:D::", long_options, NULL);
+    c = getopt_long(argc, argv, "hvdf:n:z:b:c:s:t:a:E:W:w:y:P:p:I:R:A:S:M:D::T:", long_options, NULL);
     if (c == -1)
       break;
     switch (c) {
@@ -149,10 +212,22 @@ int process_options(int argc, char *argv[]) {
         printf("  -b    --bgcolour\tuse specified background colour\n");
         printf("  -c    --fgcolour\tuse specified foreground colour\n");
         printf("  -s    --fgcoloursel\tcolour of selected item\n");
-        printf("  -t    --menutimeout\thow long before menu disappears (0 for no timeout)\n");
+        printf("  -t    --menutimeout\tseconds before menu disappears, fractions allowed (0 for no timeout)\n");
         printf("  -a    --menuanimation\tmenu animation speed (microseconds)\n");
+        printf("  -E    --exectimeout\tseconds an exec menu's program may run, fractions allowed (0 for no limit)\n");
+        printf("  -W    --scantimeout\tseconds a browse scan may take before it is abandoned, fractions allowed (0 for no limit)\n");
+        printf("  -w    --prewarm\tseconds idle between walks of the browse directories, to keep them cached (0 for never)\n");
+        printf("  -y    --prewarmdepth\tlevels of sub directories walked below each browse directory\n");
+        printf("  -P    --pixmapbudget\tkilobytes of pixmaps kept for hidden menus (0 frees them on hide, default: 8192)\n");
+        printf("  -p    --pagesize\titems moved by pageup/pagedown (default: 10)\n");
+        printf("  -I    --icondir\ticons for browse menus, as EXTENSION.xpm, file.xpm and directory.xpm\n");
+        printf("  -R    --statefile\tkeep the open menus here over restarts, to reopen them on show\n");
+        printf("  -A    --acceleration\trepeats before held buttons move a page, then a tenth\n"
+               "                        \tof the menu at a time, as 'page[,tenth]' (default: 10,30)\n");
+        printf("  -S    --socket\tlisten for commands on this unix domain socket\n");
         printf("  -M    --dump\t\tdump menu structure to screen\n");
         printf("  -D[x] --debug[=x]\tenable log. optional verbosity [1 .. 2] (default: 1)\n");
+        printf("  -T    --trace\t\twrite timings to this file, in chrome trace event format\n");
         return (option_exitsuccess);
       case 'v':
         printf("%s\n", options.progname);
@@ -181,17 +256,50 @@ int process_options(int argc, char *argv[]) {
         strcpy(options.fgcoloursel, optarg);
         break;
       case 't':
-        options.menutimeout = atoi(optarg);
+        options.menutimeout = seconds_to_msecs(optarg);
         break;
       case 'a':
         options.menuanimation = atoi(optarg);
         break;
+      case 'E':
+        options.exectimeout = seconds_to_msecs(optarg);
+        break;
+      case 'W':
+        options.scantimeout = seconds_to_msecs(optarg);
+        break;
+      case 'w':
+        options.prewarm = seconds_to_msecs(optarg);
+        break;
+      case 'y':
+        options.prewarmdepth = atoi(optarg);
+        break;
+      case 'P':
+        options.pixmapbudget = atoi(optarg);
+        break;
+      case 'p':
+        options.pagesize = atoi(optarg);
+        break;
+      case 'I':
+        strcpy(options.icondir, optarg);
+        break;
+      case 'R':
+        strcpy(options.statefile, optarg);
+        break;
+      case 'A':
+        set_acceleration(optarg);
+        break;
+      case 'S':
+        strcpy(options.controlsocket, optarg);
+        break;
       case 'M':
         options.dump = 1;
         break;
       case 'D':
         options.debug = optarg ? atoi(optarg) : 1;
         break;
+      case 'T':
+        strcpy(options.tracefile, optarg);
+        break;
       default:
         printf("Usage: %s [options]\n", argv[0]);
         return (option_exitfailure);
@@ -28,8 +28,19 @@ struct animenu_options {
   char fgcolour[BUFSIZE + 1];
   char fgcoloursel[BUFSIZE + 1];
   char lircrcfile[BUFSIZE + 1];
-  int menutimeout;
+  char controlsocket[BUFSIZE + 1];
+  char tracefile[BUFSIZE + 1];
+  char icondir[BUFSIZE + 1];
+  char statefile[BUFSIZE + 1];
+  int menutimeout; /* msecs */
+  int exectimeout; /* msecs */
+  int scantimeout; /* msecs */
+  int prewarm; /* msecs idle between walks */
+  int prewarmdepth;
+  int pixmapbudget; /* kilobytes */
   int menuanimation;
+  int pagesize;
+  unsigned int accelpage, accelpercent; /* repeat counts */
   int daemonise;
   int dump;
   int debug;
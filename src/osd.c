@@ -14,105 +14,86 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <getopt.h>
-#include <time.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <signal.h>
-#include <sys/ioctl.h>
-
-/* x11 includes */
-#include <X11/X.h>
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#include <X11/Xatom.h>
-#include <X11/Xmd.h>
-#include <X11/extensions/shape.h>
-
-#ifdef HAVE_LIBXFT
-#include <X11/Xft/Xft.h>
-#endif /* HAVE_LIBXFT */
-
-#include "osd.h"
-
-extern int menuanimation;
-
-struct osdprivate {
-  struct osdcontext *parent;
-  Display *display;
-  Window win;
-  GC greengc, lightgrngc;
-  int left, top;
-  int width, height;
-  int itemcount;
-  int mapped;
-  Pixmap bg_initial, bg_shaded;
-  XFontStruct *font;
-  int fontascent, fontdescent;
-  int itemheight;
-  int itemoffset;
-#ifdef HAVE_LIBXFT
-  XftDraw *xftdraw;
-  XftColor bgcolour, fgcolour;
-#endif  /* HAVE_LIBXFT */
-  int frame;
-  void *userdata;
-  void *(*osdidcallback) (void *ud, struct osditemdata **osdid);
-};
-
-static unsigned long getcolour(struct osdcontext *osd, char *colourname) {
-  XColor colour;
-  XWindowAttributes winattr;
-  XGetWindowAttributes(osd->priv->display, RootWindow(osd->priv->display, DefaultScreen(osd->priv->display)), &winattr);
-
-  colour.pixel = 0;
-  if ((XParseColor(osd->priv->display, winattr.colormap, colourname, &colour)) == 0)
-    fprintf(stderr, "XParseColor: cannot resolve colorname %s.\n", colourname);
-  colour.flags = DoRed | DoGreen | DoBlue;
-  XAllocColor(osd->priv->display, winattr.colormap, &colour);
-  return colour.pixel;
+
+#include "osdbackend.h"
+#include "trace.h"
+
+/* the layout and animation of the menus, drawn through a backend. x11
+ * unless set otherwise before the first osd is created */
+static struct osdbackend *osd_backend = &osd_x11backend;
+static int osd_ready = FALSE;
+
+/* a stale menu has a bar down the right edge of its window */
+#define OSD_STALEWIDTH 3
+#define OSD_STALEMARGIN 6
+
+void osd_setbackend(enum osd_backends backend) {
+  osd_backend = backend == osd_memory ? &osd_memorybackend : &osd_x11backend;
 }
 
-static void osd_sync(struct osdcontext *osd) {
-  XFlush(osd->priv->display);
+/* the rgba pixels of an osd window, with the memory backend only */
+int osd_pixels(struct osdcontext *osd, const unsigned char **rgba, int *width, int *height) {
+  if (osd_backend != &osd_memorybackend)
+    return(FALSE);
+  return(osdmem_pixels(osd, rgba, width, height));
 }
 
-static void osd_showselected(struct osdcontext *osd, int selected) {
-  int i;
+static void osd_markrow(struct osdcontext *osd, int row) {
+  struct osdprivate *osdp = osd->priv;
+  osd_backend->mark(osd, osdp->width - OSD_STALEMARGIN, row * osdp->itemheight,
+                    OSD_STALEWIDTH, osdp->itemheight);
+}
+
+/* marked rows are the ones fully drawn in, the rest are marked as the
+ * animation reaches them */
+static void osd_setstale(struct osdcontext *osd, int stale) {
+  struct osdprivate *osdp = osd->priv;
   struct osditemdata *oid = NULL;
-  void *ud = osd->priv->userdata;
+  void *ud = osdp->userdata;
+  int i = 0;
 
-  i = 0;
+  if (stale == osdp->stale)
+    return;
+  osdp->stale = stale;
+  if (!osdp->mapped)
+    return;
   while (ud) {
-    ud = osd->priv->osdidcallback(ud, &oid);
-    if (oid) {
-      if (oid->title)
-        XDrawString(osd->priv->display, osd->priv->win,
-                    i == selected ? osd->priv->lightgrngc : osd->priv->greengc,
-                    16, i * osd->priv->itemheight + osd->priv->itemoffset,
-                    oid->title, strlen(oid->title));
+    ud = osdp->osdidcallback(ud, &oid);
+    if (oid && oid->lastedge >= osdp->width) {
+      if (stale)
+        osd_markrow(osd, i);
+      else
+        osd_backend->copy(osd, TRUE, osdp->width - OSD_STALEMARGIN, i * osdp->itemheight,
+                          OSD_STALEWIDTH, osdp->itemheight);
     }
     ++i;
   }
-  osd_sync(osd);
+  osd_backend->flush(osd);
 }
 
-static void osd_initanim(struct osdcontext *osd) {
-  XMapRaised(osd->priv->display, osd->priv->win);
-
-  XCopyArea(osd->priv->display, osd->priv->win, osd->priv->bg_initial,
-            osd->priv->greengc, 0, 0, osd->priv->width, osd->priv->height, 0, 0);
-
-  XCopyArea(osd->priv->display, osd->priv->win, osd->priv->bg_shaded,
-            osd->priv->greengc, 0, 0, osd->priv->width, osd->priv->height, 0, 0);
-
-#ifdef HAVE_LIBXFT
-  XftDrawRect(osd->priv->xftdraw, &osd->priv->bgcolour, 0, 0, osd->priv->width, osd->priv->height);
-#endif /* HAVE_LIBXFT */
+/* only the rows going in or out of selection are redrawn */
+static void osd_showselected(struct osdcontext *osd, int selected) {
+  struct osdprivate *osdp = osd->priv;
 
-  osd->priv->mapped = 1;
+  if (selected < 0 || selected >= osdp->itemcount)
+    selected = -1;
+  if (!osdp->mapped || selected == osdp->selected)
+    return;
+  _tracestart(tracestart);
+  if (osdp->selected != -1) {
+    osd_backend->title(osd, osdp->selected, 0, FALSE);
+    if (osdp->stale)
+      osd_markrow(osd, osdp->selected);
+  }
+  if (selected != -1) {
+    osd_backend->title(osd, selected, 0, TRUE);
+    if (osdp->stale)
+      osd_markrow(osd, selected);
+  }
+  osdp->selected = selected;
+  osd_backend->flush(osd);
+  _traceend(tracestart, "showselected", NULL);
 }
 
 static void osd_showframe(struct osdcontext *osd, int frame) {
@@ -121,12 +102,17 @@ static void osd_showframe(struct osdcontext *osd, int frame) {
   struct osditemdata *oid = NULL;
   void *ud = osd->priv->userdata;
 
-  if (osd->priv->mapped == 0)
-    osd_initanim(osd);
+  _tracestart(tracestart);
+  if (osd->priv->mapped == 0) {
+    osd_backend->map(osd);
+    osd->priv->mapped = 1;
+    osd->priv->selected = -1;
+  }
 
   items = osd->priv->height / osd->priv->itemheight;
 
   if (frame <= 1) {
+    osd->priv->selected = -1;
     i = 0;
     while (ud) {
       ud = osd->priv->osdidcallback(ud, &oid);
@@ -152,21 +138,20 @@ static void osd_showframe(struct osdcontext *osd, int frame) {
         t = pow(t, 3);
         edge = osd->priv->width * (1 - t);
         if (edge > oid->lastedge) {
-          XCopyArea(osd->priv->display, osd->priv->bg_shaded, osd->priv->win,
-                    osd->priv->greengc, 0, i * osd->priv->itemheight,
-                    edge, osd->priv->itemheight, 0, i * osd->priv->itemheight);
-          if (oid->title) {
-            XDrawString(osd->priv->display, osd->priv->win,
-                        osd->priv->greengc, edge - (osd->priv->width - 16),
-                        i * osd->priv->itemheight + osd->priv->itemoffset, oid->title, strlen(oid->title));
-          }
+          osd_backend->copy(osd, TRUE, 0, i * osd->priv->itemheight,
+                            edge, osd->priv->itemheight);
+          if (oid->title)
+            osd_backend->title(osd, i, edge - osd->priv->width, FALSE);
+          if (osd->priv->stale && edge >= osd->priv->width)
+            osd_markrow(osd, i);
           oid->lastedge = edge;
         }
       }
     }
     ++i;
   }
-  osd_sync(osd);
+  osd_backend->flush(osd);
+  _traceend(tracestart, "showframe", NULL);
 }
 
 static void osd_show(struct osdcontext *osd, int menuanimation) {
@@ -183,6 +168,7 @@ static void osd_hideframe(struct osdcontext *osd, int frame) {
   struct osditemdata *oid = NULL;
   void *ud = osd->priv->userdata;
 
+  _tracestart(tracestart);
   if (osd->priv->mapped) {
     items = osd->priv->height / osd->priv->itemheight;
     if (frame <= 1) {
@@ -208,30 +194,26 @@ static void osd_hideframe(struct osdcontext *osd, int frame) {
         t = pow(t, 3);
         edge = t * osd->priv->width;
         if (edge > oid->lastedge) {
-          XCopyArea(osd->priv->display, osd->priv->bg_initial, osd->priv->win,
-                    osd->priv->greengc, 0, i * osd->priv->itemheight,
-                    edge, osd->priv->itemheight, 0, i * osd->priv->itemheight);
-          XCopyArea(osd->priv->display, osd->priv->bg_shaded, osd->priv->win,
-                    osd->priv->greengc, edge, i * osd->priv->itemheight,
-                    osd->priv->width - edge, osd->priv->itemheight, edge, i * osd->priv->itemheight);
+          osd_backend->copy(osd, FALSE, 0, i * osd->priv->itemheight,
+                            edge, osd->priv->itemheight);
+          osd_backend->copy(osd, TRUE, edge, i * osd->priv->itemheight,
+                            osd->priv->width - edge, osd->priv->itemheight);
           if (oid->title) {
-            XDrawString(osd->priv->display, osd->priv->win,
-                        osd->priv->greengc, edge + 16, i * osd->priv->itemheight + osd->priv->itemoffset,
-                        oid->title, strlen(oid->title));
+            osd_backend->title(osd, i, edge, FALSE);
             oid->lastedge = edge;
           }
         }
       }
       ++i;
     }
-    osd_sync(osd);
+    osd_backend->flush(osd);
 
     if (frame >= 1950) {
-      XUnmapWindow(osd->priv->display, osd->priv->win);
-      XFlush(osd->priv->display);
+      osd_backend->unmap(osd);
       osd->priv->mapped = 0;
     }
   }
+  _traceend(tracestart, "hideframe", NULL);
 }
 
 static void osd_hide(struct osdcontext *osd, int menuanimation) {
@@ -245,43 +227,26 @@ static void osd_hide(struct osdcontext *osd, int menuanimation) {
 static void osd_dispose(struct osdcontext *osd, int menuanimation) {
   if (osd->priv->mapped)
     osd->hide(osd, menuanimation);
+  osd_backend->release(osd);
+  free(osd->priv);
   free(osd);
 }
 
-#ifdef HAVE_LIBXFT
-void setup_xft(struct osdcontext *osd) {
-  XRenderColor colourtmp;
-  int screen_num = DefaultScreen(osd->priv->display);
-
-  osd->priv->xftdraw =
-    XftDrawCreate(osd->priv->display,
-                  (Drawable) osd->priv->bg_shaded,
-                  DefaultVisual(osd->priv->display, screen_num), DefaultColormap(osd->priv->display, screen_num));
-
-  if (!osd->priv->xftdraw)
-    return;
+int osd_connection() {
+  return(osd_backend->connection());
+}
 
-  colourtmp.red = 0x0;
-  colourtmp.green = 0x0;
-  colourtmp.blue = 0x0;
-  colourtmp.alpha = 0x006000;
-  XftColorAllocValue(osd->priv->display,
-                     DefaultVisual(osd->priv->display, screen_num),
-                     DefaultColormap(osd->priv->display, screen_num), &colourtmp, &osd->priv->bgcolour);
-
-  colourtmp.red = 0x0;
-  colourtmp.green = 0x0;
-  colourtmp.blue = 0x0;
-  colourtmp.alpha = 0x00ffff;
-  XftColorAllocValue(osd->priv->display,
-                     DefaultVisual(osd->priv->display, screen_num),
-                     DefaultColormap(osd->priv->display, screen_num), &colourtmp, &osd->priv->fgcolour);
+/* block until everything drawn so far is on screen */
+void osd_wait() {
+  osd_backend->wait();
+}
 
+void osd_events() {
+  osd_backend->events();
 }
-#endif /* HAVE_LIBXFT */
 
 static void osd_calcdimensions(struct osdcontext *osd) {
-  int width = 0, height = 0, count = 0;
+  int width = 0, height = 0, count = 0, icons = FALSE;
   struct osdprivate *osdp = osd->priv;
   if (osdp->osdidcallback) {
     int w = 0;
@@ -290,30 +255,55 @@ static void osd_calcdimensions(struct osdcontext *osd) {
     while (ud) {
       ud = osdp->osdidcallback(ud, &osdid);
       if (osdid->title)
-        w = XTextWidth(osdp->font, osdid->title, strlen(osdid->title));
+        w = osd_backend->textwidth(osdid->title, strlen(osdid->title));
       if (w > width)
         width = w;
+      if (osdid->icon && osd_backend->icons)
+        icons = TRUE;
       height += osd->priv->itemheight;
       ++count;
     }
   }
-  osdp->width = _max(width, 100);
+  /* icons are drawn square, at the height of an item */
+  osdp->textleft = 16 + (icons ? osdp->itemheight : 0);
+  osdp->width = (_max(width, 100)) + osdp->textleft - 16;
   osdp->height = _max(height, osd->priv->itemheight);
   osdp->itemcount = _max(count, 1);
 }
 
+/* sub menus open just below and to the right of the parent's window */
+static void osd_anchor(struct osdcontext *osd, struct osdcontext *parent) {
+  osd->priv->parent = parent;
+  if (parent) {
+    osd->priv->top = parent->priv->top + (3 * osd->priv->itemheight) / 2;
+    osd->priv->left = parent->priv->left + parent->priv->width;
+  } else {
+    osd->priv->top = 32;
+    osd->priv->left = 32;
+  }
+}
+
+/* move the window alongside a new parent, as a shared menu may be
+ * opened from more than one place */
+static void osd_place(struct osdcontext *osd, struct osdcontext *parent) {
+  int left = osd->priv->left, top = osd->priv->top;
+  osd_anchor(osd, parent);
+  if (left != osd->priv->left || top != osd->priv->top)
+    osd_backend->move(osd);
+}
+
 struct osdcontext *osd_create(struct osdcontext *parent,
                               void *(*osdidcallback) (void *userdata, struct osditemdata **osdid),
                               void *userdata) {
   struct osdcontext *osd;
   struct osdprivate *osdp;
-  XGCValues gcval;
-  XSizeHints sizehints;
-  XSetWindowAttributes xattributes;
-  XCharStruct extent;
-  int txt_direction, screen_num;
 
-  struct animenu_options* options = get_options();
+  _tracestart(tracestart);
+  if (!osd_ready) {
+    if (!osd_backend->setup())
+      return(NULL);
+    osd_ready = TRUE;
+  }
 
   if (!(osd = malloc(sizeof(struct osdcontext)))) {
     fprintf(stderr, "cannot allocate osdcontext!\n");
@@ -322,15 +312,18 @@ struct osdcontext *osd_create(struct osdcontext *parent,
 
   if (!(osdp = malloc(sizeof(struct osdprivate)))) {
     fprintf(stderr, "cannot allocate osdcontext!\n");
+    free(osd);
     return(NULL);
   }
 
   osd->priv = osdp;
 
   osdp->mapped = 0;
+  osdp->selected = -1;
+  osdp->stale = FALSE;
+  osdp->surface = NULL;
   osd->priv->osdidcallback = osdidcallback;
   osd->priv->userdata = userdata;
-  osd->priv->parent = parent;
 
   osd->dispose = osd_dispose;
   osd->show = osd_show;
@@ -338,31 +331,10 @@ struct osdcontext *osd_create(struct osdcontext *parent,
   osd->showselected = osd_showselected;
   osd->hide = osd_hide;
   osd->hideframe = osd_hideframe;
-  if (!(osd->priv->display = XOpenDisplay(NULL))) {
-    fprintf(stderr, "unable to open display\n");
-    exit(EXIT_FAILURE);
-  }
+  osd->place = osd_place;
+  osd->setstale = osd_setstale;
 
-  screen_num = DefaultScreen(osdp->display);
-
-  osd->priv->font = XLoadQueryFont(osd->priv->display, options->fontspec);
-
-  if (osd->priv->font == NULL) {
-    fprintf(stderr, "trying alternate font\n");
-    osd->priv->font = XLoadQueryFont(osd->priv->display,
-           "-sony-fixed-medium-r-normal--36-*-100-100-c-*-iso8859-*");
-    if (osd->priv->font == NULL) {
-      fprintf(stderr, "trying \"fixed\" font\n");
-      osd->priv->font = XLoadQueryFont(osd->priv->display, "fixed");
-      if (osd->priv->font == NULL) {
-        fprintf(stderr, "error: could not load any font. xfs or your x-server is broken?\n");
-        return(NULL);
-      }
-    }
-  }
-
-  XTextExtents(osd->priv->font, "The quick brown fox jumps over the lazy dog!", 44,
-               &txt_direction, &osd->priv->fontascent, &osd->priv->fontdescent, &extent);
+  osd_backend->fontextents(&osd->priv->fontascent, &osd->priv->fontdescent);
 
   osd->priv->itemheight = osd->priv->fontascent + osd->priv->fontdescent + 2;
   osd->priv->itemoffset = osd->priv->fontascent + 2;
@@ -371,65 +343,16 @@ struct osdcontext *osd_create(struct osdcontext *parent,
 
   osd->priv->width += 40;
 
-  if (parent) {
-    osd->priv->top = parent->priv->top + (3 * osd->priv->itemheight) / 2;
-    osd->priv->left = parent->priv->left + parent->priv->width;
-  } else {
-    osd->priv->top = 32;
-    osd->priv->left = 32;
+  osd_anchor(osd, parent);
+  _tracecount(trace_bytes, sizeof(struct osdcontext) + sizeof(struct osdprivate));
+
+  if (!osd_backend->create(osd)) {
+    free(osdp);
+    free(osd);
+    return(NULL);
   }
-  sizehints.flags = USSize | USPosition;
-
-  sizehints.x = osd->priv->left;
-  sizehints.y = osd->priv->top;
-
-  sizehints.width = osd->priv->width;
-  sizehints.height = osd->priv->height;
-  xattributes.save_under = True;
-  xattributes.override_redirect = True;
-  xattributes.cursor = None;
-
-  osd->priv->win = XCreateWindow(osd->priv->display,
-                                 DefaultRootWindow(osd->priv->display),
-                                 sizehints.x, sizehints.y,
-                                 osd->priv->width, osd->priv->height, 0,
-                                 CopyFromParent,   // depth
-                                 CopyFromParent,   // class
-                                 CopyFromParent,   // visual
-                                 0,  // valuemask
-                                 0); // attributes
-
-  XSetWMNormalHints(osd->priv->display, osd->priv->win, &sizehints);
-  XChangeWindowAttributes(osd->priv->display, osd->priv->win, CWSaveUnder | CWOverrideRedirect, &xattributes);
-  XStoreName(osd->priv->display, osd->priv->win, "osd");
-
-  gcval.foreground = getcolour(osd, options->fgcolour);
-  gcval.background = getcolour(osd, options->bgcolour);
-  gcval.graphics_exposures = 0;
-
-  osd->priv->greengc = XCreateGC(osd->priv->display, osd->priv->win,
-                                 GCForeground | GCBackground | GCGraphicsExposures, &gcval);
-
-  gcval.foreground = getcolour(osd, options->fgcoloursel);
-  osd->priv->lightgrngc = XCreateGC(osd->priv->display, osd->priv->win,
-                                    GCForeground | GCBackground | GCGraphicsExposures, &gcval);
-
-  XSetFont(osd->priv->display, osd->priv->greengc, osd->priv->font->fid);
-  XSetFont(osd->priv->display, osd->priv->lightgrngc, osd->priv->font->fid);
-
-  osd->priv->bg_initial = XCreatePixmap(osd->priv->display,
-                                        DefaultRootWindow(osd->priv->display),
-                                        osd->priv->width, osd->priv->height,
-                                        DefaultDepth(osd->priv->display, screen_num));
-
-  osd->priv->bg_shaded = XCreatePixmap(osd->priv->display,
-                                       DefaultRootWindow(osd->priv->display),
-                                       osd->priv->width, osd->priv->height,
-                                       DefaultDepth(osd->priv->display, screen_num));
-
-#ifdef HAVE_LIBXFT
-  setup_xft(osd);
-#endif
+
+  _traceend(tracestart, "osd_create", NULL);
 
   return(osd);
 }
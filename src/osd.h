@@ -21,8 +21,13 @@
 
 #define OSD_MAXANIMFRAME 2000
 
+/* where osds are drawn. memory is an offscreen rgba buffer per osd, for
+ * running without a display */
+enum osd_backends {osd_x11, osd_memory};
+
 struct osditemdata {
   char *title;
+  const char *icon; /* xpm file, or NULL */
   int frameoffset;
   int lastedge;
 };
@@ -34,6 +39,8 @@ struct osdcontext {
   void (*showselected) (struct osdcontext *osd, int selected);
   void (*hide) (struct osdcontext *osd, int menuanimation);
   void (*hideframe) (struct osdcontext *osd, int frame);
+  void (*place) (struct osdcontext *osd, struct osdcontext *parent);
+  void (*setstale) (struct osdcontext *osd, int stale);
   void (*setstringcallback) (struct osdcontext *osd,
                              void *(*stringcallback) (void *userdata, struct osditemdata **osdid),
                              void *userdata);
@@ -43,5 +50,10 @@ struct osdcontext {
 struct osdcontext *osd_create(struct osdcontext *parent,
                               void *(*idcallback) (void *userdata, struct osditemdata **osdid),
                               void *userdata);
+void osd_setbackend(enum osd_backends backend);
+int osd_pixels(struct osdcontext *osd, const unsigned char **rgba, int *width, int *height);
+int osd_connection();
+void osd_events();
+void osd_wait();
 
 #endif
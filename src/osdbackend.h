@@ -0,0 +1,78 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_OSDBACKEND_H
+#define ANIMENU_OSDBACKEND_H
+
+#include "osd.h"
+
+/* for osd.c and the backends only */
+
+struct osdprivate {
+  struct osdcontext *parent;
+  void *surface; /* the backend's window and backgrounds */
+  int left, top;
+  int width, height;
+  int itemcount;
+  int mapped;
+  int fontascent, fontdescent;
+  int itemheight;
+  int itemoffset;
+  int textleft; /* titles start here, after any icons */
+  int selected; /* the row last drawn selected, or -1 */
+  int stale; /* the items shown may be out of date */
+  int frame;
+  void *userdata;
+  void *(*osdidcallback) (void *ud, struct osditemdata **osdid);
+};
+
+/* osd.c lays out and animates the menus, and a backend does the drawing.
+ * each osd has a window and two backgrounds of the same size, the
+ * initial one being what was beneath the window, the other shaded.
+ * frames are drawn by copying strips of either background to the
+ * window, then titles over them.
+ *
+ * 'setup' runs once before the first osd, returning FALSE if the
+ * backend can't be used. 'create' makes the osd's surface, at the size
+ * and position in its private data, which 'move' follows as it changes.
+ * 'map' shows the window and takes the backgrounds, and 'unmap' hides
+ * it. 'copy' takes a strip from the shaded background if 'shaded',
+ * otherwise the initial one. 'flush' ends each frame.
+ *
+ * titles are rendered once per osd, so 'title' only copies. it draws a
+ * row's title 'offset' pixels right of where it rests, within the
+ * window. at rest (an offset of 0) the row is drawn whole, over the
+ * shaded background, and in the selected colour if 'selected'. 'mark'
+ * fills a rectangle of the window in the title colour */
+struct osdbackend {
+  int (*setup) ();
+  void (*fontextents) (int *ascent, int *descent);
+  int (*textwidth) (const char *text, int len);
+  int (*create) (struct osdcontext *osd);
+  void (*release) (struct osdcontext *osd);
+  void (*move) (struct osdcontext *osd);
+  void (*map) (struct osdcontext *osd);
+  void (*unmap) (struct osdcontext *osd);
+  void (*copy) (struct osdcontext *osd, int shaded, int x, int y, int width, int height);
+  void (*title) (struct osdcontext *osd, int row, int offset, int selected);
+  void (*mark) (struct osdcontext *osd, int x, int y, int width, int height);
+  void (*flush) (struct osdcontext *osd);
+  int (*connection) ();
+  void (*events) ();
+  void (*wait) ();
+  int icons; /* whether item icons are drawn, left of the titles */
+};
+
+extern struct osdbackend osd_x11backend;
+extern struct osdbackend osd_memorybackend;
+
+int osdmem_pixels(struct osdcontext *osd, const unsigned char **rgba, int *width, int *height);
+
+#endif
@@ -0,0 +1,380 @@
+
+/*
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "osdbackend.h"
+
+/* an offscreen backend, drawing each osd to rgba buffers in memory, so
+ * menus can be laid out and animated without a display. the pixels are
+ * there to be read back with osd_pixels */
+
+#define MEM_GLYPHWIDTH 8
+#define MEM_GLYPHHEIGHT 16
+#define MEM_ASCENT 12
+#define MEM_SHADE 0x60
+
+/* printable ascii from dejavu sans mono, 8x16 cells with the baseline
+ * at row 12. the top bit is the leftmost pixel */
+static const unsigned char mem_glyphs[95][MEM_GLYPHHEIGHT] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ' ' */
+  {0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, /* '!' */
+  {0x00, 0x00, 0x00, 0x28, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '"' */
+  {0x00, 0x00, 0x12, 0x12, 0x16, 0x7f, 0x24, 0x24, 0xfe, 0x28, 0x48, 0x48, 0x00, 0x00, 0x00, 0x00}, /* '#' */
+  {0x00, 0x00, 0x00, 0x08, 0x3e, 0x49, 0x48, 0x38, 0x0e, 0x09, 0x49, 0x3e, 0x08, 0x08, 0x00, 0x00}, /* '$' */
+  {0x00, 0x00, 0x00, 0x60, 0x90, 0x90, 0x62, 0x1c, 0x66, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00}, /* '%' */
+  {0x00, 0x00, 0x00, 0x1c, 0x20, 0x20, 0x30, 0x49, 0x4d, 0x45, 0x62, 0x3d, 0x00, 0x00, 0x00, 0x00}, /* '&' */
+  {0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '\'' */
+  {0x00, 0x0c, 0x08, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00, 0x00}, /* '(' */
+  {0x00, 0x30, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x30, 0x00, 0x00, 0x00}, /* ')' */
+  {0x00, 0x00, 0x00, 0x08, 0x49, 0x3e, 0x1c, 0x6b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '*' */
+  {0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0xfe, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '+' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00, 0x00}, /* ',' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '-' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* '.' */
+  {0x00, 0x00, 0x00, 0x02, 0x04, 0x04, 0x08, 0x08, 0x18, 0x10, 0x10, 0x20, 0x20, 0x40, 0x00, 0x00}, /* '/' */
+  {0x00, 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x49, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00}, /* '0' */
+  {0x00, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00, 0x00}, /* '1' */
+  {0x00, 0x00, 0x00, 0x3e, 0x43, 0x01, 0x01, 0x02, 0x0c, 0x18, 0x20, 0x7f, 0x00, 0x00, 0x00, 0x00}, /* '2' */
+  {0x00, 0x00, 0x00, 0x3e, 0x41, 0x01, 0x03, 0x1c, 0x03, 0x01, 0x43, 0x3e, 0x00, 0x00, 0x00, 0x00}, /* '3' */
+  {0x00, 0x00, 0x00, 0x06, 0x0a, 0x1a, 0x12, 0x22, 0x42, 0x7f, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00}, /* '4' */
+  {0x00, 0x00, 0x00, 0x7e, 0x40, 0x40, 0x7c, 0x03, 0x01, 0x01, 0x43, 0x3c, 0x00, 0x00, 0x00, 0x00}, /* '5' */
+  {0x00, 0x00, 0x00, 0x1e, 0x21, 0x40, 0x5e, 0x63, 0x41, 0x41, 0x23, 0x1e, 0x00, 0x00, 0x00, 0x00}, /* '6' */
+  {0x00, 0x00, 0x00, 0x7f, 0x02, 0x02, 0x04, 0x04, 0x08, 0x18, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00}, /* '7' */
+  {0x00, 0x00, 0x00, 0x3e, 0x41, 0x41, 0x41, 0x3e, 0x63, 0x41, 0x61, 0x3e, 0x00, 0x00, 0x00, 0x00}, /* '8' */
+  {0x00, 0x00, 0x00, 0x3c, 0x62, 0x41, 0x41, 0x63, 0x3d, 0x01, 0x42, 0x3c, 0x00, 0x00, 0x00, 0x00}, /* '9' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* ':' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00, 0x00}, /* ';' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x70, 0x70, 0x0e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '<' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '=' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x38, 0x07, 0x07, 0x38, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '>' */
+  {0x00, 0x00, 0x00, 0x38, 0x44, 0x04, 0x08, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, /* '?' */
+  {0x00, 0x00, 0x00, 0x1e, 0x33, 0x21, 0x47, 0x49, 0x49, 0x49, 0x47, 0x20, 0x30, 0x1e, 0x00, 0x00}, /* '@' */
+  {0x00, 0x00, 0x00, 0x08, 0x14, 0x14, 0x14, 0x22, 0x22, 0x3e, 0x63, 0x41, 0x00, 0x00, 0x00, 0x00}, /* 'A' */
+  {0x00, 0x00, 0x00, 0x7e, 0x41, 0x41, 0x41, 0x7e, 0x41, 0x41, 0x41, 0x7e, 0x00, 0x00, 0x00, 0x00}, /* 'B' */
+  {0x00, 0x00, 0x00, 0x1e, 0x21, 0x40, 0x40, 0x40, 0x40, 0x40, 0x21, 0x1e, 0x00, 0x00, 0x00, 0x00}, /* 'C' */
+  {0x00, 0x00, 0x00, 0x7c, 0x42, 0x41, 0x41, 0x41, 0x41, 0x41, 0x42, 0x7c, 0x00, 0x00, 0x00, 0x00}, /* 'D' */
+  {0x00, 0x00, 0x00, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x00, 0x00, 0x00, 0x00}, /* 'E' */
+  {0x00, 0x00, 0x00, 0x7f, 0x40, 0x40, 0x40, 0x7f, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00}, /* 'F' */
+  {0x00, 0x00, 0x00, 0x1e, 0x21, 0x40, 0x40, 0x43, 0x41, 0x41, 0x21, 0x1e, 0x00, 0x00, 0x00, 0x00}, /* 'G' */
+  {0x00, 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x7f, 0x41, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00}, /* 'H' */
+  {0x00, 0x00, 0x00, 0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7c, 0x00, 0x00, 0x00, 0x00}, /* 'I' */
+  {0x00, 0x00, 0x00, 0x1c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x44, 0x38, 0x00, 0x00, 0x00, 0x00}, /* 'J' */
+  {0x00, 0x00, 0x00, 0x42, 0x44, 0x48, 0x50, 0x70, 0x48, 0x44, 0x44, 0x42, 0x00, 0x00, 0x00, 0x00}, /* 'K' */
+  {0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7f, 0x00, 0x00, 0x00, 0x00}, /* 'L' */
+  {0x00, 0x00, 0x00, 0x63, 0x63, 0x55, 0x55, 0x55, 0x49, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00}, /* 'M' */
+  {0x00, 0x00, 0x00, 0x61, 0x61, 0x51, 0x51, 0x49, 0x45, 0x45, 0x43, 0x43, 0x00, 0x00, 0x00, 0x00}, /* 'N' */
+  {0x00, 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00}, /* 'O' */
+  {0x00, 0x00, 0x00, 0x7e, 0x43, 0x41, 0x41, 0x43, 0x7e, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00}, /* 'P' */
+  {0x00, 0x00, 0x00, 0x1c, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x23, 0x1e, 0x06, 0x02, 0x00, 0x00}, /* 'Q' */
+  {0x00, 0x00, 0x00, 0x7e, 0x43, 0x41, 0x41, 0x7e, 0x42, 0x41, 0x41, 0x40, 0x00, 0x00, 0x00, 0x00}, /* 'R' */
+  {0x00, 0x00, 0x00, 0x3e, 0x61, 0x40, 0x60, 0x3e, 0x03, 0x01, 0x43, 0x3e, 0x00, 0x00, 0x00, 0x00}, /* 'S' */
+  {0x00, 0x00, 0x00, 0xfe, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, /* 'T' */
+  {0x00, 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x3e, 0x00, 0x00, 0x00, 0x00}, /* 'U' */
+  {0x00, 0x00, 0x00, 0x41, 0x63, 0x22, 0x22, 0x22, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00, 0x00, 0x00}, /* 'V' */
+  {0x00, 0x00, 0x00, 0x81, 0x81, 0x81, 0x5a, 0x5a, 0x5a, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00}, /* 'W' */
+  {0x00, 0x00, 0x00, 0x63, 0x22, 0x14, 0x1c, 0x08, 0x14, 0x36, 0x22, 0x41, 0x00, 0x00, 0x00, 0x00}, /* 'X' */
+  {0x00, 0x00, 0x00, 0x82, 0x44, 0x28, 0x28, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, /* 'Y' */
+  {0x00, 0x00, 0x00, 0x7f, 0x03, 0x06, 0x04, 0x08, 0x10, 0x30, 0x60, 0x7f, 0x00, 0x00, 0x00, 0x00}, /* 'Z' */
+  {0x00, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1c, 0x00, 0x00, 0x00}, /* '[' */
+  {0x00, 0x00, 0x00, 0x40, 0x20, 0x20, 0x10, 0x10, 0x18, 0x08, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00}, /* '\\' */
+  {0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00, 0x00}, /* ']' */
+  {0x00, 0x00, 0x00, 0x10, 0x28, 0x44, 0xc6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '^' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00}, /* '_' */
+  {0x00, 0x00, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '`' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x02, 0x3e, 0x42, 0x46, 0x3a, 0x00, 0x00, 0x00, 0x00}, /* 'a' */
+  {0x00, 0x40, 0x40, 0x40, 0x40, 0x7c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x7c, 0x00, 0x00, 0x00, 0x00}, /* 'b' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x40, 0x40, 0x40, 0x22, 0x1c, 0x00, 0x00, 0x00, 0x00}, /* 'c' */
+  {0x00, 0x02, 0x02, 0x02, 0x02, 0x3e, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3e, 0x00, 0x00, 0x00, 0x00}, /* 'd' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x7e, 0x40, 0x62, 0x3c, 0x00, 0x00, 0x00, 0x00}, /* 'e' */
+  {0x00, 0x0c, 0x10, 0x10, 0x10, 0x7c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, /* 'f' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3a, 0x02, 0x22, 0x1c, 0x00}, /* 'g' */
+  {0x00, 0x40, 0x40, 0x40, 0x40, 0x5c, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, /* 'h' */
+  {0x00, 0x10, 0x00, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7c, 0x00, 0x00, 0x00, 0x00}, /* 'i' */
+  {0x00, 0x08, 0x00, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x70, 0x00}, /* 'j' */
+  {0x00, 0x40, 0x40, 0x40, 0x40, 0x44, 0x48, 0x50, 0x70, 0x48, 0x44, 0x42, 0x00, 0x00, 0x00, 0x00}, /* 'k' */
+  {0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0e, 0x00, 0x00, 0x00, 0x00}, /* 'l' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x7f, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, 0x00, 0x00, 0x00}, /* 'm' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x5c, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, /* 'n' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3c, 0x00, 0x00, 0x00, 0x00}, /* 'o' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x42, 0x42, 0x42, 0x66, 0x7c, 0x40, 0x40, 0x40, 0x00}, /* 'p' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3a, 0x02, 0x02, 0x02, 0x00}, /* 'q' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00}, /* 'r' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x42, 0x40, 0x3c, 0x02, 0x42, 0x3c, 0x00, 0x00, 0x00, 0x00}, /* 's' */
+  {0x00, 0x00, 0x00, 0x10, 0x10, 0x7e, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0e, 0x00, 0x00, 0x00, 0x00}, /* 't' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x46, 0x3a, 0x00, 0x00, 0x00, 0x00}, /* 'u' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x66, 0x24, 0x24, 0x3c, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, /* 'v' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x81, 0x81, 0x5a, 0x5a, 0x5a, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00}, /* 'w' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x24, 0x18, 0x18, 0x18, 0x24, 0x66, 0x00, 0x00, 0x00, 0x00}, /* 'x' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x22, 0x24, 0x24, 0x14, 0x18, 0x08, 0x08, 0x10, 0x30, 0x00}, /* 'y' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x02, 0x04, 0x18, 0x20, 0x40, 0x7e, 0x00, 0x00, 0x00, 0x00}, /* 'z' */
+  {0x00, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x60, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0c, 0x00, 0x00, 0x00}, /* '{' */
+  {0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00}, /* '|' */
+  {0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x0c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x60, 0x00, 0x00, 0x00}, /* '}' */
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* '~' */
+};
+
+/* 'titles' holds every row's title at rest, a byte a pixel, rendered
+ * on first show. titles are painted from it wherever they are */
+struct memsurface {
+  unsigned char *win, *bg_initial, *bg_shaded;
+  unsigned char *titles;
+  int width, height;
+};
+
+static unsigned char mem_fg[4], mem_fgsel[4];
+
+#define _surface(OSD) ((struct memsurface *) (OSD)->priv->surface)
+
+/* colours as x would take them, though only the rgb:, # and a few
+ * named forms */
+static void mem_getcolour(const char *name, unsigned char *rgba) {
+  static const struct { const char *name; unsigned int rgb; } names[] = {
+    {"black", 0x000000}, {"white", 0xffffff}, {"red", 0xff0000}, {"green", 0x00ff00},
+    {"blue", 0x0000ff}, {"yellow", 0xffff00}, {"cyan", 0x00ffff}, {"magenta", 0xff00ff},
+    {"grey", 0xbebebe}, {"gray", 0xbebebe}, {NULL, 0}
+  };
+  unsigned int r, g, b, rgb = 0xffffff;
+  int i;
+
+  if (sscanf(name, "rgb:%2x/%2x/%2x", &r, &g, &b) == 3 ||
+      sscanf(name, "#%2x%2x%2x", &r, &g, &b) == 3)
+    rgb = (r << 16) | (g << 8) | b;
+  else {
+    for (i = 0; names[i].name; ++i) {
+      if (strcasecmp(names[i].name, name) == 0)
+        break;
+    }
+    if (names[i].name)
+      rgb = names[i].rgb;
+    else
+      fprintf(stderr, "cannot resolve colour '%s', using white\n", name);
+  }
+  rgba[0] = rgb >> 16;
+  rgba[1] = (rgb >> 8) & 0xff;
+  rgba[2] = rgb & 0xff;
+  rgba[3] = 0xff;
+}
+
+static int mem_setup() {
+  struct animenu_options* options = get_options();
+  mem_getcolour(options->fgcolour, mem_fg);
+  mem_getcolour(options->fgcoloursel, mem_fgsel);
+  return(TRUE);
+}
+
+static void mem_fontextents(int *ascent, int *descent) {
+  *ascent = MEM_ASCENT;
+  *descent = MEM_GLYPHHEIGHT - MEM_ASCENT;
+}
+
+static int mem_textwidth(const char *text, int len) {
+  return(len * MEM_GLYPHWIDTH);
+}
+
+static void mem_freebuffers(struct memsurface *surface) {
+  free(surface->win);
+  free(surface->bg_initial);
+  free(surface->bg_shaded);
+  free(surface->titles);
+  surface->win = surface->bg_initial = surface->bg_shaded = surface->titles = NULL;
+}
+
+static int mem_create(struct osdcontext *osd) {
+  struct memsurface *surface;
+
+  if (!(surface = calloc(1, sizeof(struct memsurface)))) {
+    fprintf(stderr, "cannot allocate osdcontext!\n");
+    return(FALSE);
+  }
+  surface->width = osd->priv->width;
+  surface->height = osd->priv->height;
+  osd->priv->surface = surface;
+  return(TRUE);
+}
+
+static void mem_release(struct osdcontext *osd) {
+  mem_freebuffers(_surface(osd));
+  free(_surface(osd));
+  osd->priv->surface = NULL;
+}
+
+static void mem_move(struct osdcontext *osd) {
+}
+
+/* glyphs are rendered solid into the title mask, clipped to it */
+static void mem_rendertext(struct memsurface *surface, int x, int y, const char *text) {
+  const unsigned char *glyph;
+  unsigned char c;
+  int row, col, px, py;
+
+  y -= MEM_ASCENT;
+  for (; *text && x < surface->width; ++text, x += MEM_GLYPHWIDTH) {
+    if (x + MEM_GLYPHWIDTH <= 0)
+      continue;
+    c = *text;
+    glyph = mem_glyphs[(c < ' ' || c > '~' ? '?' : c) - ' '];
+    for (row = 0; row < MEM_GLYPHHEIGHT; ++row) {
+      py = y + row;
+      if (py < 0 || py >= surface->height || !glyph[row])
+        continue;
+      for (col = 0; col < MEM_GLYPHWIDTH; ++col) {
+        px = x + col;
+        if (px >= 0 && px < surface->width && (glyph[row] & (0x80 >> col)))
+          surface->titles[(size_t) py * surface->width + px] = 1;
+      }
+    }
+  }
+}
+
+static void mem_rendertitles(struct osdcontext *osd) {
+  struct osdprivate *osdp = osd->priv;
+  struct osditemdata *oid = NULL;
+  void *ud = osdp->userdata;
+  int i = 0;
+
+  while (ud) {
+    ud = osdp->osdidcallback(ud, &oid);
+    if (oid && oid->title)
+      mem_rendertext(_surface(osd), osdp->textleft, i * osdp->itemheight + osdp->itemoffset,
+                     oid->title);
+    ++i;
+  }
+}
+
+/* there's nothing beneath the window, so the initial background is
+ * clear and the shaded one the clear shaded, as xft would draw it */
+static void mem_map(struct osdcontext *osd) {
+  struct memsurface *surface = _surface(osd);
+  size_t size = (size_t) surface->width * surface->height * 4, i;
+
+  if (!surface->win) {
+    surface->win = calloc(1, size);
+    surface->bg_initial = calloc(1, size);
+    surface->bg_shaded = calloc(1, size);
+    surface->titles = calloc(1, size / 4);
+    if (!surface->win || !surface->bg_initial || !surface->bg_shaded || !surface->titles) {
+      fprintf(stderr, "cannot allocate osd buffers!\n");
+      mem_freebuffers(surface);
+      return;
+    }
+    for (i = 3; i < size; i += 4)
+      surface->bg_shaded[i] = MEM_SHADE;
+    mem_rendertitles(osd);
+  } else
+    memset(surface->win, 0, size);
+}
+
+static void mem_unmap(struct osdcontext *osd) {
+}
+
+static void mem_copy(struct osdcontext *osd, int shaded, int x, int y, int width, int height) {
+  struct memsurface *surface = _surface(osd);
+  unsigned char *from;
+  size_t offset;
+
+  if (!surface->win)
+    return;
+  if (x < 0) {
+    width += x;
+    x = 0;
+  }
+  if (y < 0) {
+    height += y;
+    y = 0;
+  }
+  if (width > surface->width - x)
+    width = surface->width - x;
+  if (height > surface->height - y)
+    height = surface->height - y;
+  if (width <= 0 || height <= 0)
+    return;
+  from = shaded ? surface->bg_shaded : surface->bg_initial;
+  for (; height > 0; --height, ++y) {
+    offset = ((size_t) y * surface->width + x) * 4;
+    memcpy(surface->win + offset, from + offset, (size_t) width * 4);
+  }
+}
+
+static void mem_title(struct osdcontext *osd, int row, int offset, int selected) {
+  struct memsurface *surface = _surface(osd);
+  const unsigned char *colour = selected ? mem_fgsel : mem_fg;
+  int y, x, top = row * osd->priv->itemheight, bottom = top + osd->priv->itemheight;
+  int left = offset > 0 ? offset : 0;
+  int right = offset < 0 ? surface->width + offset : surface->width;
+
+  if (!surface->win)
+    return;
+  if (offset == 0)
+    mem_copy(osd, TRUE, 0, top, surface->width, osd->priv->itemheight);
+  if (bottom > surface->height)
+    bottom = surface->height;
+  for (y = top; y < bottom; ++y) {
+    for (x = left; x < right; ++x) {
+      if (surface->titles[(size_t) y * surface->width + x - offset])
+        memcpy(surface->win + ((size_t) y * surface->width + x) * 4, colour, 4);
+    }
+  }
+}
+
+static void mem_mark(struct osdcontext *osd, int x, int y, int width, int height) {
+  struct memsurface *surface = _surface(osd);
+  int right = x + width, bottom = y + height, i;
+
+  if (!surface->win)
+    return;
+  if (x < 0)
+    x = 0;
+  if (y < 0)
+    y = 0;
+  if (right > surface->width)
+    right = surface->width;
+  if (bottom > surface->height)
+    bottom = surface->height;
+  for (; y < bottom; ++y) {
+    for (i = x; i < right; ++i)
+      memcpy(surface->win + ((size_t) y * surface->width + i) * 4, mem_fg, 4);
+  }
+}
+
+static void mem_flush(struct osdcontext *osd) {
+}
+
+static int mem_connection() {
+  return(-1);
+}
+
+static void mem_events() {
+}
+
+static void mem_wait() {
+}
+
+int osdmem_pixels(struct osdcontext *osd, const unsigned char **rgba, int *width, int *height) {
+  struct memsurface *surface = _surface(osd);
+  if (!surface || !surface->win)
+    return(FALSE);
+  *rgba = surface->win;
+  *width = surface->width;
+  *height = surface->height;
+  return(TRUE);
+}
+
+struct osdbackend osd_memorybackend = {
+  mem_setup, mem_fontextents, mem_textwidth, mem_create, mem_release, mem_move,
+  mem_map, mem_unmap, mem_copy, mem_title, mem_mark,
+  mem_flush, mem_connection, mem_events, mem_wait,
+  FALSE
+};
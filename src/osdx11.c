@@ -0,0 +1,609 @@
+/*
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* x11 includes */
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/Xmd.h>
+#include <X11/extensions/shape.h>
+
+#ifdef HAVE_LIBXFT
+#include <X11/Xft/Xft.h>
+#endif /* HAVE_LIBXFT */
+
+#ifdef HAVE_LIBXPM
+#include <X11/xpm.h>
+#endif /* HAVE_LIBXPM */
+
+#include "osdbackend.h"
+#include "trace.h"
+
+/* single connection shared by all osd windows */
+static Display *osd_display = NULL;
+static unsigned long osd_lastrequest = 0;
+
+/* every osd draws with the same font and colours, so these are set up
+ * once with the first osd rather than per window */
+static XFontStruct *osd_font = NULL;
+static GC osd_greengc, osd_lightgrngc;
+static GC osd_maskgc = NULL; /* for the depth 1 title masks */
+static unsigned long osd_fgpixel, osd_selpixel;
+#ifdef HAVE_LIBXFT
+static XftColor osd_bgcolour, osd_fgcolour;
+#endif  /* HAVE_LIBXFT */
+
+/* windows and pixmaps released by disposed osds, for reuse by the next
+ * ones created. pixmaps are allocated to a bucket size rather than the
+ * exact window size, so an osd of a similar size can take them as they
+ * are and only the window itself is resized */
+#define OSD_POOLSIZE 8
+#define OSD_BUCKETWIDTH 64
+
+/* titles are drawn once into 'titles', a bitmap of every row at rest.
+ * moving titles are filled through it as a stipple, and at rest rows
+ * are copied from 'strip' or 'stripsel', the shaded background with the
+ * titles over it, so no frame has the server rasterise any text */
+struct x11surface {
+  Window win;
+  Pixmap bg_initial, bg_shaded; /* None until the window is first shown */
+  Pixmap titles, strip, stripsel;
+  GC titlegc; /* fills the foreground through 'titles' */
+  int titlesdrawn; /* false until drawn for the osd holding the surface */
+  int pixwidth, pixheight;
+  long bytes;
+  int idle;
+  struct x11surface *older, *newer;
+#ifdef HAVE_LIBXFT
+  XftDraw *xftdraw;
+#endif  /* HAVE_LIBXFT */
+};
+
+static struct x11surface *osd_pool[OSD_POOLSIZE];
+static int osd_pooled = 0;
+
+/* pixmaps of hidden windows, least recently shown first. they are kept
+ * for the next show until they add up to more than 'pixmapbudget' */
+static struct x11surface *osd_oldest = NULL, *osd_newest = NULL;
+static long osd_idlebytes = 0;
+
+#define _surface(OSD) ((struct x11surface *) (OSD)->priv->surface)
+
+static Display *osd_getdisplay() {
+  if (!osd_display && !(osd_display = XOpenDisplay(NULL))) {
+    fprintf(stderr, "unable to open display\n");
+    exit(EXIT_FAILURE);
+  }
+  return(osd_display);
+}
+
+static unsigned long getcolour(char *colourname) {
+  XColor colour;
+  XWindowAttributes winattr;
+  XGetWindowAttributes(osd_display, RootWindow(osd_display, DefaultScreen(osd_display)), &winattr);
+
+  colour.pixel = 0;
+  if ((XParseColor(osd_display, winattr.colormap, colourname, &colour)) == 0)
+    fprintf(stderr, "XParseColor: cannot resolve colorname %s.\n", colourname);
+  colour.flags = DoRed | DoGreen | DoBlue;
+  XAllocColor(osd_display, winattr.colormap, &colour);
+  return colour.pixel;
+}
+
+static void x11_flush(struct osdcontext *osd) {
+  _tracestart(tracestart);
+  _tracecount(trace_xrequests, NextRequest(osd_display) - osd_lastrequest);
+  osd_lastrequest = NextRequest(osd_display);
+  XFlush(osd_display);
+  _traceend(tracestart, "x flush", NULL);
+}
+
+static void osd_unidle(struct x11surface *surface) {
+  if (!surface->idle)
+    return;
+  if (surface->older)
+    surface->older->newer = surface->newer;
+  else
+    osd_oldest = surface->newer;
+  if (surface->newer)
+    surface->newer->older = surface->older;
+  else
+    osd_newest = surface->older;
+  surface->older = surface->newer = NULL;
+  osd_idlebytes -= surface->bytes;
+  surface->idle = FALSE;
+}
+
+static void osd_freepixmaps(struct x11surface *surface) {
+  if (surface->bg_initial == None)
+    return;
+  osd_unidle(surface);
+#ifdef HAVE_LIBXFT
+  if (surface->xftdraw)
+    XftDrawDestroy(surface->xftdraw);
+  surface->xftdraw = NULL;
+#endif /* HAVE_LIBXFT */
+  XFreeGC(osd_display, surface->titlegc);
+  XFreePixmap(osd_display, surface->bg_initial);
+  XFreePixmap(osd_display, surface->bg_shaded);
+  XFreePixmap(osd_display, surface->titles);
+  XFreePixmap(osd_display, surface->strip);
+  XFreePixmap(osd_display, surface->stripsel);
+  surface->bg_initial = surface->bg_shaded = None;
+  surface->titles = surface->strip = surface->stripsel = None;
+  surface->titlesdrawn = FALSE;
+  surface->bytes = 0;
+}
+
+static void osd_allocpixmaps(struct x11surface *surface, int width, int height) {
+  int screen_num = DefaultScreen(osd_display);
+  int depth = DefaultDepth(osd_display, screen_num);
+  Window root = DefaultRootWindow(osd_display);
+  XGCValues gcval;
+
+  surface->pixwidth = width;
+  surface->pixheight = height;
+  surface->bg_initial = XCreatePixmap(osd_display, root, width, height, depth);
+  surface->bg_shaded = XCreatePixmap(osd_display, root, width, height, depth);
+  surface->strip = XCreatePixmap(osd_display, root, width, height, depth);
+  surface->stripsel = XCreatePixmap(osd_display, root, width, height, depth);
+  surface->titles = XCreatePixmap(osd_display, root, width, height, 1);
+  surface->bytes = 4L * width * height * (depth > 16 ? 4 : (depth > 8 ? 2 : 1)) +
+                   width * height / 8;
+
+  gcval.foreground = osd_fgpixel;
+  gcval.fill_style = FillStippled;
+  gcval.stipple = surface->titles;
+  gcval.graphics_exposures = 0;
+  surface->titlegc = XCreateGC(osd_display, root,
+                               GCForeground | GCFillStyle | GCStipple | GCGraphicsExposures, &gcval);
+  if (!osd_maskgc) {
+    gcval.font = osd_font->fid;
+    osd_maskgc = XCreateGC(osd_display, surface->titles, GCFont | GCGraphicsExposures, &gcval);
+  }
+  surface->titlesdrawn = FALSE;
+#ifdef HAVE_LIBXFT
+  surface->xftdraw = XftDrawCreate(osd_display, (Drawable) surface->bg_shaded,
+                                   DefaultVisual(osd_display, screen_num),
+                                   DefaultColormap(osd_display, screen_num));
+#endif /* HAVE_LIBXFT */
+}
+
+/* a hidden window's pixmaps join the idle list, and the least recently
+ * shown are freed while the list is over budget */
+static void osd_setidle(struct x11surface *surface) {
+  long budget = (long) get_options()->pixmapbudget * 1024;
+
+  if (surface->bg_initial != None && !surface->idle) {
+    surface->older = osd_newest;
+    surface->newer = NULL;
+    if (osd_newest)
+      osd_newest->newer = surface;
+    else
+      osd_oldest = surface;
+    osd_newest = surface;
+    osd_idlebytes += surface->bytes;
+    surface->idle = TRUE;
+  }
+  while (osd_idlebytes > budget && osd_oldest)
+    osd_freepixmaps(osd_oldest);
+}
+
+/* widths round up to a multiple of OSD_BUCKETWIDTH and heights to a
+ * power of two items, so menus differing by a few items share a bucket */
+static void osd_bucket(struct osdprivate *osdp, int *width, int *height) {
+  int rows = 1;
+  while (rows < osdp->itemcount)
+    rows <<= 1;
+  *width = ((osdp->width + OSD_BUCKETWIDTH - 1) / OSD_BUCKETWIDTH) * OSD_BUCKETWIDTH;
+  *height = _max(rows * osdp->itemheight, osdp->height);
+}
+
+/* take a window from the pool, preferring one with pixmaps already of
+ * the right bucket, then one without any. the window is resized in place
+ * and any pixmaps of the wrong size are left to be replaced on show */
+static int osd_checkout(struct osdcontext *osd) {
+  struct osdprivate *osdp = osd->priv;
+  struct x11surface *surface;
+  int width, height, i, found = -1;
+
+  if (osd_pooled == 0)
+    return(FALSE);
+
+  osd_bucket(osdp, &width, &height);
+  for (i = 0; i < osd_pooled; ++i) {
+    surface = osd_pool[i];
+    if (surface->bg_initial == None)
+      found = i;
+    else if (surface->pixwidth == width && surface->pixheight == height) {
+      found = i;
+      break;
+    }
+  }
+  if (found == -1)
+    found = osd_pooled - 1;
+
+  surface = osd_pool[found];
+  osd_pool[found] = osd_pool[--osd_pooled];
+  if (surface->pixwidth != width || surface->pixheight != height)
+    osd_freepixmaps(surface);
+
+  surface->titlesdrawn = FALSE;
+  osdp->surface = surface;
+  XMoveResizeWindow(osd_display, surface->win,
+                    osdp->left, osdp->top, osdp->width, osdp->height);
+  return(TRUE);
+}
+
+/* hand the window back to the pool, or free it if the pool is full */
+static void x11_release(struct osdcontext *osd) {
+  struct osdprivate *osdp = osd->priv;
+  struct x11surface *surface = _surface(osd);
+
+  if (osdp->mapped) {
+    XUnmapWindow(osd_display, surface->win);
+    osdp->mapped = 0;
+    osd_setidle(surface);
+  }
+  if (osd_pooled < OSD_POOLSIZE)
+    osd_pool[osd_pooled++] = surface;
+  else {
+    osd_freepixmaps(surface);
+    XDestroyWindow(osd_display, surface->win);
+    free(surface);
+  }
+  XFlush(osd_display);
+}
+
+#ifdef HAVE_LIBXPM
+/* icons are decoded once to server side pixmaps, and shared by every
+ * osd showing them. they're keyed by file and the size they're drawn
+ * at. files that won't load are kept too, without a pixmap, so they are
+ * only tried once */
+struct osdicon {
+  char *path;
+  int size;
+  Pixmap pixmap, mask;
+  int width, height;
+  struct osdicon *next;
+};
+
+static struct osdicon *osd_icons = NULL;
+
+static struct osdicon *osd_geticon(const char *path, int size) {
+  struct osdicon *icon;
+  XpmAttributes attributes;
+
+  for (icon = osd_icons; icon; icon = icon->next) {
+    if (icon->size == size && strcmp(icon->path, path) == 0)
+      return(icon);
+  }
+  if (!(icon = malloc(sizeof(struct osdicon))))
+    return(NULL);
+  if (!(icon->path = strdup(path))) {
+    free(icon);
+    return(NULL);
+  }
+  _tracestart(tracestart);
+  icon->size = size;
+  icon->mask = None;
+  attributes.valuemask = 0;
+  if (XpmReadFileToPixmap(osd_display, DefaultRootWindow(osd_display), (char *) path,
+                          &icon->pixmap, &icon->mask, &attributes) == XpmSuccess) {
+    icon->width = attributes.width;
+    icon->height = attributes.height;
+    XpmFreeAttributes(&attributes);
+  } else {
+    fprintf(stderr, "cannot load icon '%s'\n", path);
+    icon->pixmap = None;
+  }
+  icon->next = osd_icons;
+  osd_icons = icon;
+  _traceend(tracestart, "icon", path);
+  return(icon);
+}
+
+/* icons go into the shaded background, left of the titles, so the
+ * animation frames copy them in with it. larger icons are cropped */
+static void osd_drawicons(struct osdcontext *osd) {
+  struct osdprivate *osdp = osd->priv;
+  struct osditemdata *oid = NULL;
+  struct osdicon *icon;
+  void *ud = osdp->userdata;
+  int i = 0, size = osdp->itemheight, w, h, x, y, clipped = FALSE;
+
+  while (ud) {
+    ud = osdp->osdidcallback(ud, &oid);
+    if (oid && oid->icon && (icon = osd_geticon(oid->icon, size)) && icon->pixmap != None) {
+      w = icon->width < size ? icon->width : size;
+      h = icon->height < size ? icon->height : size;
+      x = 8 + (size - w) / 2;
+      y = i * size + (size - h) / 2;
+      XSetClipMask(osd_display, osd_greengc, icon->mask);
+      XSetClipOrigin(osd_display, osd_greengc, x, y);
+      XCopyArea(osd_display, icon->pixmap, _surface(osd)->bg_shaded, osd_greengc,
+                0, 0, w, h, x, y);
+      clipped = TRUE;
+    }
+    ++i;
+  }
+  if (clipped)
+    XSetClipMask(osd_display, osd_greengc, None);
+}
+#endif /* HAVE_LIBXPM */
+
+static void osd_drawtitles(struct osdcontext *osd) {
+  struct osdprivate *osdp = osd->priv;
+  struct x11surface *surface = _surface(osd);
+  struct osditemdata *oid = NULL;
+  void *ud = osdp->userdata;
+  int i = 0;
+
+  _tracestart(tracestart);
+  XSetForeground(osd_display, osd_maskgc, 0);
+  XFillRectangle(osd_display, surface->titles, osd_maskgc, 0, 0,
+                 surface->pixwidth, surface->pixheight);
+  XSetForeground(osd_display, osd_maskgc, 1);
+  while (ud) {
+    ud = osdp->osdidcallback(ud, &oid);
+    if (oid && oid->title)
+      XDrawString(osd_display, surface->titles, osd_maskgc, osdp->textleft,
+                  i * osdp->itemheight + osdp->itemoffset, oid->title, strlen(oid->title));
+    ++i;
+  }
+  surface->titlesdrawn = TRUE;
+  _traceend(tracestart, "titles", NULL);
+}
+
+/* the shaded background with the titles over it, in either colour */
+static void osd_drawstrips(struct osdcontext *osd) {
+  struct x11surface *surface = _surface(osd);
+  int width = osd->priv->width, height = osd->priv->height;
+
+  XSetTSOrigin(osd_display, surface->titlegc, 0, 0);
+  XCopyArea(osd_display, surface->bg_shaded, surface->strip, osd_greengc,
+            0, 0, width, height, 0, 0);
+  XFillRectangle(osd_display, surface->strip, surface->titlegc, 0, 0, width, height);
+  XCopyArea(osd_display, surface->bg_shaded, surface->stripsel, osd_greengc,
+            0, 0, width, height, 0, 0);
+  XSetForeground(osd_display, surface->titlegc, osd_selpixel);
+  XFillRectangle(osd_display, surface->stripsel, surface->titlegc, 0, 0, width, height);
+  XSetForeground(osd_display, surface->titlegc, osd_fgpixel);
+}
+
+static void x11_map(struct osdcontext *osd) {
+  struct x11surface *surface = _surface(osd);
+  int width, height;
+
+  /* pixmaps are only needed while shown, so are first allocated here */
+  if (surface->bg_initial == None) {
+    osd_bucket(osd->priv, &width, &height);
+    osd_allocpixmaps(surface, width, height);
+  } else
+    osd_unidle(surface);
+
+  XMapRaised(osd_display, surface->win);
+
+  XCopyArea(osd_display, surface->win, surface->bg_initial,
+            osd_greengc, 0, 0, osd->priv->width, osd->priv->height, 0, 0);
+
+  XCopyArea(osd_display, surface->win, surface->bg_shaded,
+            osd_greengc, 0, 0, osd->priv->width, osd->priv->height, 0, 0);
+
+#ifdef HAVE_LIBXFT
+  if (surface->xftdraw)
+    XftDrawRect(surface->xftdraw, &osd_bgcolour, 0, 0, osd->priv->width, osd->priv->height);
+#endif /* HAVE_LIBXFT */
+#ifdef HAVE_LIBXPM
+  osd_drawicons(osd);
+#endif /* HAVE_LIBXPM */
+  if (!surface->titlesdrawn)
+    osd_drawtitles(osd);
+  osd_drawstrips(osd);
+}
+
+static void x11_unmap(struct osdcontext *osd) {
+  XUnmapWindow(osd_display, _surface(osd)->win);
+  osd_setidle(_surface(osd));
+  XFlush(osd_display);
+}
+
+static void x11_copy(struct osdcontext *osd, int shaded, int x, int y, int width, int height) {
+  struct x11surface *surface = _surface(osd);
+  XCopyArea(osd_display, shaded ? surface->bg_shaded : surface->bg_initial, surface->win,
+            osd_greengc, x, y, width, height, x, y);
+}
+
+static void x11_title(struct osdcontext *osd, int row, int offset, int selected) {
+  struct osdprivate *osdp = osd->priv;
+  struct x11surface *surface = _surface(osd);
+  int y = row * osdp->itemheight;
+  int left = offset > 0 ? offset : 0;
+  int right = offset < 0 ? osdp->width + offset : osdp->width;
+
+  if (surface->strip == None)
+    return;
+  if (offset == 0)
+    XCopyArea(osd_display, selected ? surface->stripsel : surface->strip, surface->win,
+              osd_greengc, 0, y, osdp->width, osdp->itemheight, 0, y);
+  else if (right > left) {
+    /* the stipple repeats, so the fill is kept to the one shifted copy */
+    if (selected)
+      XSetForeground(osd_display, surface->titlegc, osd_selpixel);
+    XSetTSOrigin(osd_display, surface->titlegc, offset, 0);
+    XFillRectangle(osd_display, surface->win, surface->titlegc,
+                   left, y, right - left, osdp->itemheight);
+    if (selected)
+      XSetForeground(osd_display, surface->titlegc, osd_fgpixel);
+  }
+}
+
+static void x11_mark(struct osdcontext *osd, int x, int y, int width, int height) {
+  XFillRectangle(osd_display, _surface(osd)->win, osd_greengc, x, y, width, height);
+}
+
+static void x11_move(struct osdcontext *osd) {
+  XMoveWindow(osd_display, _surface(osd)->win, osd->priv->left, osd->priv->top);
+}
+
+static int x11_textwidth(const char *text, int len) {
+  return(XTextWidth(osd_font, text, len));
+}
+
+static void x11_fontextents(int *ascent, int *descent) {
+  XCharStruct extent;
+  int txt_direction;
+  XTextExtents(osd_font, "The quick brown fox jumps over the lazy dog!", 44,
+               &txt_direction, ascent, descent, &extent);
+}
+
+static int x11_connection() {
+  return(ConnectionNumber(osd_getdisplay()));
+}
+
+/* block until the server has processed everything sent so far */
+static void x11_wait() {
+  XSync(osd_getdisplay(), False);
+}
+
+static void x11_events() {
+  XEvent event;
+  Display *display = osd_getdisplay();
+  while (XPending(display))
+    XNextEvent(display, &event);
+}
+
+#ifdef HAVE_LIBXFT
+static void setup_xft() {
+  XRenderColor colourtmp;
+  int screen_num = DefaultScreen(osd_display);
+
+  colourtmp.red = 0x0;
+  colourtmp.green = 0x0;
+  colourtmp.blue = 0x0;
+  colourtmp.alpha = 0x006000;
+  XftColorAllocValue(osd_display,
+                     DefaultVisual(osd_display, screen_num),
+                     DefaultColormap(osd_display, screen_num), &colourtmp, &osd_bgcolour);
+
+  colourtmp.red = 0x0;
+  colourtmp.green = 0x0;
+  colourtmp.blue = 0x0;
+  colourtmp.alpha = 0x00ffff;
+  XftColorAllocValue(osd_display,
+                     DefaultVisual(osd_display, screen_num),
+                     DefaultColormap(osd_display, screen_num), &colourtmp, &osd_fgcolour);
+
+}
+#endif /* HAVE_LIBXFT */
+
+/* load the font and create the gcs, against the root window so they
+ * suit any osd window */
+static int x11_setup() {
+  struct animenu_options* options = get_options();
+  XGCValues gcval;
+
+  osd_getdisplay();
+  osd_font = XLoadQueryFont(osd_display, options->fontspec);
+
+  if (osd_font == NULL) {
+    fprintf(stderr, "trying alternate font\n");
+    osd_font = XLoadQueryFont(osd_display,
+           "-sony-fixed-medium-r-normal--36-*-100-100-c-*-iso8859-*");
+    if (osd_font == NULL) {
+      fprintf(stderr, "trying \"fixed\" font\n");
+      osd_font = XLoadQueryFont(osd_display, "fixed");
+      if (osd_font == NULL) {
+        fprintf(stderr, "error: could not load any font. xfs or your x-server is broken?\n");
+        return(FALSE);
+      }
+    }
+  }
+
+  gcval.foreground = osd_fgpixel = getcolour(options->fgcolour);
+  gcval.background = getcolour(options->bgcolour);
+  gcval.graphics_exposures = 0;
+
+  osd_greengc = XCreateGC(osd_display, DefaultRootWindow(osd_display),
+                          GCForeground | GCBackground | GCGraphicsExposures, &gcval);
+
+  gcval.foreground = osd_selpixel = getcolour(options->fgcoloursel);
+  osd_lightgrngc = XCreateGC(osd_display, DefaultRootWindow(osd_display),
+                             GCForeground | GCBackground | GCGraphicsExposures, &gcval);
+
+  XSetFont(osd_display, osd_greengc, osd_font->fid);
+  XSetFont(osd_display, osd_lightgrngc, osd_font->fid);
+
+#ifdef HAVE_LIBXFT
+  setup_xft();
+#endif
+  return(TRUE);
+}
+
+static int x11_create(struct osdcontext *osd) {
+  struct x11surface *surface;
+  XSizeHints sizehints;
+  XSetWindowAttributes xattributes;
+
+  if (osd_checkout(osd))
+    return(TRUE);
+
+  if (!(surface = calloc(1, sizeof(struct x11surface)))) {
+    fprintf(stderr, "cannot allocate osdcontext!\n");
+    return(FALSE);
+  }
+  surface->bg_initial = surface->bg_shaded = None;
+  surface->titles = surface->strip = surface->stripsel = None;
+  osd->priv->surface = surface;
+
+  sizehints.flags = USSize | USPosition;
+
+  sizehints.x = osd->priv->left;
+  sizehints.y = osd->priv->top;
+
+  sizehints.width = osd->priv->width;
+  sizehints.height = osd->priv->height;
+  xattributes.save_under = True;
+  xattributes.override_redirect = True;
+  xattributes.cursor = None;
+
+  surface->win = XCreateWindow(osd_display,
+                               DefaultRootWindow(osd_display),
+                               sizehints.x, sizehints.y,
+                               osd->priv->width, osd->priv->height, 0,
+                               CopyFromParent,   // depth
+                               CopyFromParent,   // class
+                               CopyFromParent,   // visual
+                               0,  // valuemask
+                               0); // attributes
+
+  XSetWMNormalHints(osd_display, surface->win, &sizehints);
+  XChangeWindowAttributes(osd_display, surface->win, CWSaveUnder | CWOverrideRedirect, &xattributes);
+  XStoreName(osd_display, surface->win, "osd");
+
+  return(TRUE);
+}
+
+struct osdbackend osd_x11backend = {
+  x11_setup, x11_fontextents, x11_textwidth, x11_create, x11_release, x11_move,
+  x11_map, x11_unmap, x11_copy, x11_title, x11_mark,
+  x11_flush, x11_connection, x11_events, x11_wait,
+#ifdef HAVE_LIBXPM
+  TRUE
+#else
+  FALSE
+#endif /* HAVE_LIBXPM */
+};
@@ -0,0 +1,194 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "preload.h"
+#include "menu.h"
+#include "trace.h"
+
+#define _freecfg(A) free((void*)A[0]),free((void*)A)
+
+/* reading is mostly waiting on storage, so more threads than cores */
+#define PRELOAD_THREADS 8
+
+struct preloadentry {
+  struct preloadfile file;
+  char *path;
+  int read; /* the file was read in full */
+  struct preloadentry *next, *nextqueued;
+};
+
+struct preloadprivate {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  struct preloadentry *entries;
+  struct preloadentry *queue; /* waiting for a thread */
+  int busy; /* threads reading, which may queue more */
+};
+
+/* queue a file, unless it's already known. the lock must be held */
+static void preload_add(struct preloadprivate *preloadp, const char *path) {
+  struct preloadentry *entry;
+
+  for (entry = preloadp->entries; entry; entry = entry->next) {
+    if (strcmp(entry->path, path) == 0)
+      return;
+  }
+  if (!(entry = calloc(1, sizeof(struct preloadentry))))
+    return;
+  if (!(entry->path = strdup(path))) {
+    free(entry);
+    return;
+  }
+  entry->next = preloadp->entries;
+  preloadp->entries = entry;
+  entry->nextqueued = preloadp->queue;
+  preloadp->queue = entry;
+  pthread_cond_broadcast(&preloadp->changed);
+}
+
+/* read a file into its entry, queueing the sub menu files it names as
+ * soon as they are seen. until marked 'read' the entry is this
+ * thread's alone */
+static void preload_read(struct preloadprivate *preloadp, struct preloadentry *entry) {
+  char path[PATH_MAX + 1];
+  char **itemcfg, ***items;
+  struct stat statbuf;
+  int alloc = 0;
+  FILE *f;
+
+  _tracestart(tracestart);
+  if (!(f = fopen(entry->path, "r")))
+    return;
+  if (fstat(fileno(f), &statbuf) == -1) {
+    fclose(f);
+    return;
+  }
+  while (animenu_readmenufile(f, &itemcfg)) {
+    if (entry->file.itemcount == alloc) {
+      alloc = alloc ? alloc * 2 : 16;
+      if (!(items = realloc(entry->file.items, alloc * sizeof(char**)))) {
+        _freecfg(itemcfg);
+        break;
+      }
+      entry->file.items = items;
+    }
+    entry->file.items[entry->file.itemcount++] = itemcfg;
+    if (strcmp(itemcfg[0], "menu") == 0) {
+      animenu_menupath(path, itemcfg[2]);
+      pthread_mutex_lock(&preloadp->lock);
+      preload_add(preloadp, path);
+      pthread_mutex_unlock(&preloadp->lock);
+    }
+  }
+  fclose(f);
+  entry->file.dev = statbuf.st_dev;
+  entry->file.ino = statbuf.st_ino;
+  entry->read = TRUE;
+  _traceend(tracestart, "preload", entry->path);
+}
+
+/* threads take files from the queue until it's empty and no thread is
+ * still reading, as a file being read may yet add to it */
+static void *preload_worker(void *ud) {
+  struct preloadprivate *preloadp = (struct preloadprivate *) ud;
+  struct preloadentry *entry;
+
+  pthread_mutex_lock(&preloadp->lock);
+  while (TRUE) {
+    while (!preloadp->queue && preloadp->busy > 0)
+      pthread_cond_wait(&preloadp->changed, &preloadp->lock);
+    if (!(entry = preloadp->queue))
+      break;
+    preloadp->queue = entry->nextqueued;
+    ++preloadp->busy;
+    pthread_mutex_unlock(&preloadp->lock);
+    preload_read(preloadp, entry);
+    pthread_mutex_lock(&preloadp->lock);
+    --preloadp->busy;
+    pthread_cond_broadcast(&preloadp->changed);
+  }
+  pthread_mutex_unlock(&preloadp->lock);
+  return(NULL);
+}
+
+static const struct preloadfile *preload_find(struct preloadcontext *preload, dev_t dev, ino_t ino) {
+  struct preloadentry *entry;
+  for (entry = preload->priv->entries; entry; entry = entry->next) {
+    if (entry->read && entry->file.dev == dev && entry->file.ino == ino)
+      return(&entry->file);
+  }
+  return(NULL);
+}
+
+static void preload_dispose(struct preloadcontext *preload) {
+  struct preloadentry *entry;
+  int i;
+  if (preload) {
+    while ((entry = preload->priv->entries)) {
+      preload->priv->entries = entry->next;
+      for (i = 0; i < entry->file.itemcount; ++i)
+        _freecfg(entry->file.items[i]);
+      free(entry->file.items);
+      free(entry->path);
+      free(entry);
+    }
+    pthread_mutex_destroy(&preload->priv->lock);
+    pthread_cond_destroy(&preload->priv->changed);
+    free(preload->priv);
+    free(preload);
+  }
+}
+
+/* read the menu files reachable from 'path', returning once all are
+ * read. the calling thread reads too, so if no threads can be started
+ * the files are still read, one after another */
+struct preloadcontext *preload_create(const char *path) {
+  struct preloadcontext *preload;
+  struct preloadprivate *preloadp;
+  pthread_t threads[PRELOAD_THREADS - 1];
+  int i, started;
+
+  if (!(preload = malloc(sizeof(struct preloadcontext)))) {
+    fprintf(stderr, "cannot allocate preloadcontext!\n");
+    return(NULL);
+  }
+  if (!(preloadp = malloc(sizeof(struct preloadprivate)))) {
+    fprintf(stderr, "cannot allocate preloadcontext!\n");
+    free(preload);
+    return(NULL);
+  }
+  memset(preloadp, 0, sizeof(struct preloadprivate));
+  pthread_mutex_init(&preloadp->lock, NULL);
+  pthread_cond_init(&preloadp->changed, NULL);
+  preload->priv = preloadp;
+  preload->dispose = preload_dispose;
+  preload->find = preload_find;
+
+  _tracestart(tracestart);
+  preload_add(preloadp, path);
+  for (started = 0; started < PRELOAD_THREADS - 1; ++started) {
+    if (pthread_create(&threads[started], NULL, preload_worker, preloadp) != 0)
+      break;
+  }
+  preload_worker(preloadp);
+  for (i = 0; i < started; ++i)
+    pthread_join(threads[i], NULL);
+  _traceend(tracestart, "preload tree", path);
+
+  return(preload);
+}
@@ -0,0 +1,40 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_PRELOAD_H
+#define ANIMENU_PRELOAD_H
+
+#include <sys/types.h>
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+
+/* menu files read ahead of building the tree. starting from the root
+ * menu file, each file it leads to is read and split into items on a
+ * pool of threads, away from X and the menu tree, so a cold start waits
+ * on the slowest file rather than on all of them in turn. nothing
+ * changes once preload_create has returned */
+struct preloadfile {
+  dev_t dev; /* identity of the file read */
+  ino_t ino;
+  char ***items; /* as returned by animenu_readmenufile */
+  int itemcount;
+};
+
+struct preloadcontext {
+  void (*dispose) (struct preloadcontext *preload);
+  const struct preloadfile *(*find) (struct preloadcontext *preload, dev_t dev, ino_t ino);
+  struct preloadprivate *priv;
+};
+
+struct preloadcontext *preload_create(const char *path);
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "prewarm.h"
+#include "trace.h"
+
+/* a pause after every burst of entries looked at, so a walk never
+ * takes more than a trickle of a slow share's attention */
+#define PREWARM_BURST 100
+#define PREWARM_PAUSE 50 /* msecs */
+
+/* linux's io priorities, which glibc has no header for */
+#define PREWARM_IOPRIO_WHO_THREAD 1
+#define PREWARM_IOPRIO_IDLE (3 << 13)
+
+enum prewarmstate {prewarm_running, prewarm_done, prewarm_stopped};
+
+/* what the walk thread and the main loop share, freed by whichever
+ * lets go last, as with a browse scan */
+struct prewarmjob {
+  int refs;
+  int state;
+  int fd; /* eventfd, written once every path has been walked */
+  char **paths;
+  int count;
+  int depth;
+  int entries; /* since the last pause */
+};
+
+struct prewarmprivate {
+  struct loopcontext *loop;
+  struct prewarmjob *job;
+  int depth;
+  void (*donecallback) (void *ud);
+  void *userdata;
+};
+
+/* walks still going, including any stuck on a hung mount. only one is
+ * started at a time */
+static int prewarm_threads = 0;
+
+static void prewarm_freepaths(char **paths, int count) {
+  int i;
+  if (paths) {
+    for (i = 0; i < count; ++i)
+      free(paths[i]);
+    free(paths);
+  }
+}
+
+static void prewarm_release(struct prewarmjob *job) {
+  if (__atomic_sub_fetch(&job->refs, 1, __ATOMIC_ACQ_REL) > 0)
+    return;
+  if (job->fd != -1)
+    close(job->fd);
+  prewarm_freepaths(job->paths, job->count);
+  free(job);
+}
+
+static int prewarm_cancelled(struct prewarmjob *job) {
+  return(__atomic_load_n(&job->state, __ATOMIC_ACQUIRE) == prewarm_stopped);
+}
+
+static void prewarm_pace(struct prewarmjob *job) {
+  struct timespec pause = {0, PREWARM_PAUSE * 1000000L};
+  if (++job->entries < PREWARM_BURST)
+    return;
+  job->entries = 0;
+  nanosleep(&pause, NULL);
+}
+
+/* stat every entry, as a browse scan would, and go on down into sub
+ * directories. symlinks aren't followed, so there are no loops */
+static void prewarm_walk(struct prewarmjob *job, char *path, size_t len, int depth) {
+  struct dirent *dirent;
+  struct stat statbuf;
+  size_t namelen;
+  DIR *d;
+
+  if (!(d = opendir(path)))
+    return;
+  while (!prewarm_cancelled(job) && (dirent = readdir(d))) {
+    if (dirent->d_name[0] == '.' &&
+        (!dirent->d_name[1] || (dirent->d_name[1] == '.' && !dirent->d_name[2])))
+      continue;
+    if (fstatat(dirfd(d), dirent->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1)
+      continue;
+    prewarm_pace(job);
+    namelen = strlen(dirent->d_name);
+    if (depth > 0 && S_ISDIR(statbuf.st_mode) && len + namelen + 2 <= PATH_MAX) {
+      path[len] = '/';
+      memcpy(path + len + 1, dirent->d_name, namelen + 1);
+      prewarm_walk(job, path, len + namelen + 1, depth - 1);
+      path[len] = '\0';
+    }
+  }
+  closedir(d);
+}
+
+static void *prewarm_thread(void *ud) {
+  struct prewarmjob *job = (struct prewarmjob *) ud;
+  char path[PATH_MAX];
+  uint64_t one = 1;
+  int running = prewarm_running, i;
+
+  /* only this thread, linux takes the calling thread for these */
+  setpriority(PRIO_PROCESS, 0, 19);
+  syscall(SYS_ioprio_set, PREWARM_IOPRIO_WHO_THREAD, 0, PREWARM_IOPRIO_IDLE);
+
+  _tracestart(tracestart);
+  for (i = 0; i < job->count && !prewarm_cancelled(job); ++i) {
+    _strncpy(path, job->paths[i], PATH_MAX);
+    prewarm_walk(job, path, strlen(path), job->depth);
+  }
+  _traceend(tracestart, "prewarm", NULL);
+
+  if (__atomic_compare_exchange_n(&job->state, &running, prewarm_done, FALSE,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) &&
+      write(job->fd, &one, sizeof(one)) == -1)
+    fprintf(stderr, "cannot signal the end of a prewarm: %s\n", strerror(errno));
+  prewarm_release(job);
+  __atomic_sub_fetch(&prewarm_threads, 1, __ATOMIC_RELEASE);
+  return(NULL);
+}
+
+/* let go of the walk, which a running thread notices at its next entry */
+static void prewarm_stop(struct prewarmcontext *prewarm) {
+  struct prewarmprivate *prewarmp = prewarm->priv;
+  int running = prewarm_running;
+
+  if (!prewarmp->job)
+    return;
+  prewarmp->loop->removefd(prewarmp->loop, prewarmp->job->fd);
+  __atomic_compare_exchange_n(&prewarmp->job->state, &running, prewarm_stopped, FALSE,
+                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+  prewarm_release(prewarmp->job);
+  prewarmp->job = NULL;
+}
+
+static void prewarm_ready(void *ud) {
+  struct prewarmcontext *prewarm = (struct prewarmcontext *) ud;
+  uint64_t count;
+
+  if (read(prewarm->priv->job->fd, &count, sizeof(count)) == -1 && errno == EAGAIN)
+    return;
+  prewarm->stop(prewarm);
+  prewarm->priv->donecallback(prewarm->priv->userdata);
+}
+
+static void prewarm_start(struct prewarmcontext *prewarm, char **paths, int count) {
+  struct prewarmprivate *prewarmp = prewarm->priv;
+  struct prewarmjob *job;
+  pthread_t thread;
+
+  if (prewarmp->job || count == 0 ||
+      __atomic_load_n(&prewarm_threads, __ATOMIC_ACQUIRE) > 0) {
+    prewarm_freepaths(paths, count);
+    return;
+  }
+  if (!(job = calloc(1, sizeof(struct prewarmjob)))) {
+    prewarm_freepaths(paths, count);
+    return;
+  }
+  job->refs = 1;
+  job->state = prewarm_running;
+  job->paths = paths;
+  job->count = count;
+  job->depth = prewarmp->depth;
+  if ((job->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 ||
+      !prewarmp->loop->addfd(prewarmp->loop, job->fd, prewarm_ready, prewarm)) {
+    prewarm_release(job);
+    return;
+  }
+  prewarmp->job = job;
+
+  /* the thread holds a reference of its own */
+  job->refs = 2;
+  __atomic_add_fetch(&prewarm_threads, 1, __ATOMIC_ACQ_REL);
+  if (pthread_create(&thread, NULL, prewarm_thread, job) != 0) {
+    fprintf(stderr, "cannot start a prewarm\n");
+    __atomic_sub_fetch(&prewarm_threads, 1, __ATOMIC_RELEASE);
+    job->refs = 1;
+    prewarm->stop(prewarm);
+    return;
+  }
+  pthread_detach(thread);
+}
+
+static void prewarm_dispose(struct prewarmcontext *prewarm) {
+  if (prewarm) {
+    prewarm->stop(prewarm);
+    free(prewarm->priv);
+    free(prewarm);
+  }
+}
+
+struct prewarmcontext *prewarm_create(struct loopcontext *loop, int depth,
+                                      void (*donecallback) (void *userdata),
+                                      void *userdata) {
+  struct prewarmcontext *prewarm;
+  struct prewarmprivate *prewarmp;
+
+  if (!(prewarm = malloc(sizeof(struct prewarmcontext)))) {
+    fprintf(stderr, "cannot allocate prewarmcontext!\n");
+    return(NULL);
+  }
+  if (!(prewarmp = calloc(1, sizeof(struct prewarmprivate)))) {
+    fprintf(stderr, "cannot allocate prewarmcontext!\n");
+    free(prewarm);
+    return(NULL);
+  }
+  prewarm->priv = prewarmp;
+  prewarm->dispose = prewarm_dispose;
+  prewarm->start = prewarm_start;
+  prewarm->stop = prewarm_stop;
+
+  prewarmp->loop = loop;
+  prewarmp->depth = depth;
+  prewarmp->donecallback = donecallback;
+  prewarmp->userdata = userdata;
+
+  return(prewarm);
+}
@@ -0,0 +1,39 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_PREWARM_H
+#define ANIMENU_PREWARM_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+#include "loop.h"
+
+/* a walk of the browse directories while the menus are idle, so their
+ * entries are still cached when next browsed. it runs on a thread of
+ * its own at idle cpu and io priority, and at a limited rate.
+ *
+ * 'start' walks 'paths' down to 'depth' levels of sub directories,
+ * taking over the array and its strings. it does nothing if a walk is
+ * already going. 'stop' ends a walk at the next entry, and is cheap
+ * enough to call on every keypress. 'donecallback' runs from the main
+ * loop once a walk has got through every path, and not after 'stop' */
+struct prewarmcontext {
+  void (*dispose) (struct prewarmcontext *prewarm);
+  void (*start) (struct prewarmcontext *prewarm, char **paths, int count);
+  void (*stop) (struct prewarmcontext *prewarm);
+  struct prewarmprivate *priv;
+};
+
+struct prewarmcontext *prewarm_create(struct loopcontext *loop, int depth,
+                                      void (*donecallback) (void *userdata),
+                                      void *userdata);
+
+#endif
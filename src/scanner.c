@@ -0,0 +1,212 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "scanner.h"
+#include "menu.h"
+#include "trace.h"
+
+/* threads stuck on a hung mount can't be stopped, only left. past this
+ * many no more scans are started, rather than pile up more of them */
+#define SCANNER_MAXHUNG 4
+
+enum scanstate {scan_running, scan_done, scan_abandoned};
+
+/* what the scan thread and the main loop share. whichever lets go last
+ * frees it, so an abandoned thread can still finish safely */
+struct scanjob {
+  int refs;
+  int state;
+  int fd; /* eventfd, written once the listing is ready */
+  char *path, *regex, *command;
+  struct filtercontext *filter;
+  int recurse;
+  struct browselisting *listing;
+};
+
+struct scannerprivate {
+  struct loopcontext *loop;
+  struct looptimer *timer;
+  struct scanjob *job;
+  void (*donecallback) (void *ud, struct browselisting *listing);
+  void *userdata;
+};
+
+static int scanner_hung = 0;
+
+static void scanner_release(struct scanjob *job) {
+  if (__atomic_sub_fetch(&job->refs, 1, __ATOMIC_ACQ_REL) > 0)
+    return;
+  if (job->fd != -1)
+    close(job->fd);
+  if (job->filter)
+    job->filter->dispose(job->filter);
+  animenu_releaselisting(job->listing);
+  free(job->path);
+  free(job->regex);
+  free(job->command);
+  free(job);
+}
+
+static void *scanner_thread(void *ud) {
+  struct scanjob *job = (struct scanjob *) ud;
+  struct browselisting *listing;
+  uint64_t one = 1;
+  int running = scan_running;
+
+  listing = animenu_scandir(job->path, job->regex, job->filter, job->command, job->recurse);
+  __atomic_store_n(&job->listing, listing, __ATOMIC_RELEASE);
+  if (__atomic_compare_exchange_n(&job->state, &running, scan_done, FALSE,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    if (write(job->fd, &one, sizeof(one)) == -1)
+      fprintf(stderr, "cannot signal the end of a scan: %s\n", strerror(errno));
+  } else
+    __atomic_sub_fetch(&scanner_hung, 1, __ATOMIC_RELAXED);
+  scanner_release(job);
+  return(NULL);
+}
+
+/* stop listening for the scan, and if it's still going, leave it */
+static void scanner_dispose(struct scannercontext *scanner) {
+  struct scannerprivate *scanp;
+  int running = scan_running;
+  if (scanner) {
+    scanp = scanner->priv;
+    if (scanp->timer)
+      scanp->loop->removetimer(scanp->loop, scanp->timer);
+    if (scanp->job) {
+      scanp->loop->removefd(scanp->loop, scanp->job->fd);
+      if (__atomic_compare_exchange_n(&scanp->job->state, &running, scan_abandoned, FALSE,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        __atomic_add_fetch(&scanner_hung, 1, __ATOMIC_RELAXED);
+      scanner_release(scanp->job);
+    }
+    free(scanp);
+    free(scanner);
+  }
+}
+
+static void scanner_finish(struct scannercontext *scanner, struct browselisting *listing) {
+  scanner->priv->donecallback(scanner->priv->userdata, listing);
+  scanner->dispose(scanner);
+}
+
+static void scanner_ready(void *ud) {
+  struct scannercontext *scanner = (struct scannercontext *) ud;
+  struct scanjob *job = scanner->priv->job;
+  uint64_t count;
+
+  if (read(job->fd, &count, sizeof(count)) == -1 && errno == EAGAIN)
+    return;
+  scanner_finish(scanner, __atomic_exchange_n(&job->listing, NULL, __ATOMIC_ACQUIRE));
+}
+
+static void scanner_timeout(void *ud) {
+  struct scannercontext *scanner = (struct scannercontext *) ud;
+  fprintf(stderr, "browse scan of '%s' timed out\n",
+          scanner->priv->job->path ? scanner->priv->job->path : scanner->priv->job->regex);
+  scanner_finish(scanner, NULL);
+}
+
+static int scanner_wait(struct scannercontext *scanner, int msecs) {
+  struct pollfd pfd;
+  pfd.fd = scanner->priv->job->fd;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, msecs) != 1)
+    return(FALSE);
+  scanner_ready(scanner);
+  return(TRUE);
+}
+
+struct scannercontext *scanner_create(struct loopcontext *loop, const char *path,
+                                      const char *regex, struct filtercontext *filter,
+                                      const char *command, int recurse, int timeout,
+                                      void (*donecallback) (void *userdata,
+                                                            struct browselisting *listing),
+                                      void *userdata) {
+  struct scannercontext *scanner;
+  struct scannerprivate *scanp;
+  struct scanjob *job;
+  pthread_t thread;
+
+  if (__atomic_load_n(&scanner_hung, __ATOMIC_RELAXED) >= SCANNER_MAXHUNG) {
+    fprintf(stderr, "too many browse scans not responding, not scanning '%s'\n",
+            path ? path : regex);
+    return(NULL);
+  }
+  if (!(scanner = malloc(sizeof(struct scannercontext)))) {
+    fprintf(stderr, "cannot allocate scannercontext!\n");
+    return(NULL);
+  }
+  if (!(scanp = calloc(1, sizeof(struct scannerprivate)))) {
+    fprintf(stderr, "cannot allocate scannercontext!\n");
+    free(scanner);
+    return(NULL);
+  }
+  scanner->priv = scanp;
+  scanner->dispose = scanner_dispose;
+  scanner->wait = scanner_wait;
+
+  scanp->loop = loop;
+  scanp->donecallback = donecallback;
+  scanp->userdata = userdata;
+
+  if (!(job = calloc(1, sizeof(struct scanjob)))) {
+    fprintf(stderr, "cannot allocate scannercontext!\n");
+    scanner->dispose(scanner);
+    return(NULL);
+  }
+  job->refs = 1;
+  job->state = scan_running;
+  job->recurse = recurse;
+  job->filter = filter ? filter->ref(filter) : NULL;
+  if ((job->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 ||
+      (path && !(job->path = strdup(path))) || !(job->regex = strdup(regex)) ||
+      !(job->command = strdup(command))) {
+    fprintf(stderr, "cannot scan '%s': %s\n", path ? path : regex, strerror(errno));
+    scanner_release(job);
+    scanner->dispose(scanner);
+    return(NULL);
+  }
+  if (!loop->addfd(loop, job->fd, scanner_ready, scanner)) {
+    scanner_release(job);
+    scanner->dispose(scanner);
+    return(NULL);
+  }
+  scanp->job = job;
+
+  /* the thread holds a reference of its own */
+  job->refs = 2;
+  if (pthread_create(&thread, NULL, scanner_thread, job) != 0) {
+    fprintf(stderr, "cannot start a scan of '%s'\n", path ? path : regex);
+    job->refs = 1;
+    job->state = scan_done;
+    scanner->dispose(scanner);
+    return(NULL);
+  }
+  pthread_detach(thread);
+
+  if (timeout > 0) {
+    if ((scanp->timer = loop->addtimer(loop, scanner_timeout, scanner)))
+      loop->settimer(loop, scanp->timer, timeout);
+  }
+
+  return(scanner);
+}
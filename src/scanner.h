@@ -0,0 +1,45 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_SCANNER_H
+#define ANIMENU_SCANNER_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+#include "loop.h"
+#include "filter.h"
+
+struct browselisting;
+
+/* a browse directory scan on a thread of its own, so a slow or hung
+ * mount can't stall the menus. 'donecallback' runs from the main loop
+ * with the listing, which it then owns, or NULL if the scan failed or
+ * ran past 'timeout'. a scan that's still going then is abandoned, its
+ * thread left to finish in its own time. the scanner disposes of itself
+ * after 'donecallback'.
+ *
+ * 'wait' blocks for up to 'msecs' for the scan, and if it is done runs
+ * 'donecallback' there and then, returning TRUE. the scanner is gone
+ * once it has */
+struct scannercontext {
+  void (*dispose) (struct scannercontext *scanner);
+  int (*wait) (struct scannercontext *scanner, int msecs);
+  struct scannerprivate *priv;
+};
+
+struct scannercontext *scanner_create(struct loopcontext *loop, const char *path,
+                                      const char *regex, struct filtercontext *filter,
+                                      const char *command, int recurse, int timeout,
+                                      void (*donecallback) (void *userdata,
+                                                            struct browselisting *listing),
+                                      void *userdata);
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "search.h"
+
+/* phone keypad digit for each letter a..z */
+static const char *t9keys = "22233344455566677778889999";
+
+/* reduce a title to its search key. in t9 mode letters become their
+ * keypad digit, and spaces become '0' */
+void search_normalise(char *dst, const char *src, int size, int t9) {
+  int len = 0, space = FALSE;
+  unsigned char c;
+
+  for (; *src && len < size - 1; ++src) {
+    c = (unsigned char) *src;
+    if (isspace(c)) {
+      space = len > 0;
+      continue;
+    }
+    if (!isalnum(c))
+      continue;
+    if (space && len < size - 2)
+      dst[len++] = t9 ? '0' : ' ';
+    space = FALSE;
+    c = tolower(c);
+    if (t9 && c >= 'a' && c <= 'z')
+      c = t9keys[c - 'a'];
+    dst[len++] = c;
+  }
+  dst[len] = '\0';
+}
+
+static int search_compare(const void *a, const void *b) {
+  const struct searchentry *e1 = (const struct searchentry *) a;
+  const struct searchentry *e2 = (const struct searchentry *) b;
+  int result = strcmp(e1->key, e2->key);
+  /* equal keys keep menu order */
+  return(result ? result : e1->index - e2->index);
+}
+
+struct searchindex *search_create(const char **titles, int count) {
+  struct searchindex *search;
+  size_t size = 0;
+  char *key;
+  int i, entries;
+
+  for (i = 0; i < count; ++i)
+    if (titles[i])
+      size += 2 * (strlen(titles[i]) + 1);
+
+  if (!(search = malloc(sizeof(struct searchindex))))
+    return(NULL);
+  search->text = malloc((count + 1) * sizeof(struct searchentry));
+  search->t9 = malloc((count + 1) * sizeof(struct searchentry));
+  search->keys = malloc(size + 1);
+  if (!search->text || !search->t9 || !search->keys) {
+    search_dispose(search);
+    return(NULL);
+  }
+
+  key = search->keys;
+  for (i = 0, entries = 0; i < count; ++i) {
+    if (!titles[i])
+      continue;
+    search_normalise(key, titles[i], strlen(titles[i]) + 1, FALSE);
+    search->text[entries].key = key;
+    search->text[entries].index = i;
+    key += strlen(key) + 1;
+    search_normalise(key, titles[i], strlen(titles[i]) + 1, TRUE);
+    search->t9[entries].key = key;
+    search->t9[entries].index = i;
+    key += strlen(key) + 1;
+    ++entries;
+  }
+  search->count = entries;
+  qsort(search->text, entries, sizeof(struct searchentry), search_compare);
+  qsort(search->t9, entries, sizeof(struct searchentry), search_compare);
+
+  return(search);
+}
+
+void search_dispose(struct searchindex *search) {
+  if (search) {
+    if (search->text)
+      free(search->text);
+    if (search->t9)
+      free(search->t9);
+    if (search->keys)
+      free(search->keys);
+    free(search);
+  }
+}
+
+/* index of the first item whose key starts with 'prefix' (already
+ * normalised), or -1. a binary search for the lower bound of the prefix */
+int search_find(struct searchindex *search, const char *prefix, int t9) {
+  struct searchentry *entries = t9 ? search->t9 : search->text;
+  int lo = 0, hi = search->count, mid;
+  size_t len = strlen(prefix);
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (strcmp(entries[mid].key, prefix) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < search->count && strncmp(entries[lo].key, prefix, len) == 0)
+    return(entries[lo].index);
+  return(-1);
+}
@@ -0,0 +1,37 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_SEARCH_H
+#define ANIMENU_SEARCH_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+
+/* sorted prefix index over a menu's item titles. keys are normalised
+ * titles (lower case, alphanumerics and single spaces only), or their
+ * phone keypad digit equivalents for t9 style entry */
+struct searchentry {
+  const char *key;
+  int index;
+};
+
+struct searchindex {
+  struct searchentry *text, *t9;
+  char *keys;
+  int count;
+};
+
+struct searchindex *search_create(const char **titles, int count);
+void search_dispose(struct searchindex *search);
+int search_find(struct searchindex *search, const char *prefix, int t9);
+void search_normalise(char *dst, const char *src, int size, int t9);
+
+#endif
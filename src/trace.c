@@ -0,0 +1,110 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+int trace_enabled = FALSE;
+
+static FILE *trace_file = NULL;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static long trace_counters[trace_maxcounters];
+static int trace_dirty = FALSE;
+static const char *trace_counternames[trace_maxcounters] = {
+  "x requests", "items built", "bytes allocated"
+};
+
+/* microseconds, the unit of the trace format */
+long trace_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static void trace_escape(const char *s) {
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      fprintf(trace_file, "\\%c", *s);
+    else if ((unsigned char) *s < 0x20)
+      fprintf(trace_file, "\\u%04x", (unsigned char) *s);
+    else
+      fputc(*s, trace_file);
+  }
+}
+
+/* counters are written as a single sample whenever a span completes
+ * after they have changed, rather than on every increment */
+static void trace_writecounters(long ts) {
+  int i;
+  fprintf(trace_file, ",\n{\"name\": \"counters\", \"ph\": \"C\", \"pid\": %d, \"ts\": %ld, \"args\": {",
+          (int) getpid(), ts);
+  for (i = 0; i < trace_maxcounters; ++i)
+    fprintf(trace_file, "%s\"%s\": %ld", i ? ", " : "", trace_counternames[i], trace_counters[i]);
+  fprintf(trace_file, "}}");
+  trace_dirty = FALSE;
+}
+
+void trace_span(const char *name, const char *detail, long start) {
+  long end = trace_now();
+  pthread_mutex_lock(&trace_lock);
+  if (trace_file) {
+    fprintf(trace_file, ",\n{\"name\": \"");
+    trace_escape(name);
+    fprintf(trace_file, "\", \"ph\": \"X\", \"pid\": %d, \"tid\": %ld, \"ts\": %ld, \"dur\": %ld",
+            (int) getpid(), (long) syscall(SYS_gettid), start, end - start);
+    if (detail) {
+      fprintf(trace_file, ", \"args\": {\"detail\": \"");
+      trace_escape(detail);
+      fprintf(trace_file, "\"}");
+    }
+    fprintf(trace_file, "}");
+    if (trace_dirty)
+      trace_writecounters(end);
+  }
+  pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_count(enum trace_counters counter, long delta) {
+  __atomic_add_fetch(&trace_counters[counter], delta, __ATOMIC_RELAXED);
+  trace_dirty = TRUE;
+}
+
+int trace_open(const char *path) {
+  if (!(trace_file = fopen(path, "w"))) {
+    fprintf(stderr, "cannot write trace file '%s'\n", path);
+    return(FALSE);
+  }
+  /* every event is written with a leading comma, so open with metadata */
+  fprintf(trace_file, "[{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+          "\"args\": {\"name\": \"animenu\"}}", (int) getpid());
+  trace_enabled = TRUE;
+  atexit(trace_close);
+  return(TRUE);
+}
+
+void trace_close() {
+  pthread_mutex_lock(&trace_lock);
+  if (trace_file) {
+    trace_enabled = FALSE;
+    trace_writecounters(trace_now());
+    fprintf(trace_file, "\n]\n");
+    fclose(trace_file);
+    trace_file = NULL;
+  }
+  pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,38 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+#ifndef ANIMENU_TRACE_H
+#define ANIMENU_TRACE_H
+
+#ifndef ANIMENU_H
+#include "animenu.h"
+#endif
+
+/* timing spans and counters, written as chrome trace event json which
+ * chrome://tracing and perfetto can load. when tracing is off a span
+ * costs a single test of 'trace_enabled' at each end */
+
+enum trace_counters {trace_xrequests, trace_items, trace_bytes, trace_maxcounters};
+
+extern int trace_enabled;
+
+#define _tracestart(V) long V = trace_enabled ? trace_now() : 0
+#define _traceend(V, NAME, DETAIL) \
+  do { if (trace_enabled) trace_span(NAME, DETAIL, V); } while (0)
+#define _tracecount(C, N) \
+  do { if (trace_enabled) trace_count(C, N); } while (0)
+
+int trace_open(const char *path);
+void trace_close();
+long trace_now();
+void trace_span(const char *name, const char *detail, long start);
+void trace_count(enum trace_counters counter, long delta);
+
+#endif
@@ -0,0 +1,302 @@
+/**
+ * animenu - lirc menu system
+ *
+ *  copyright (c) 2009, 2012-2014 by Pete Beardmore <pete.beardmore@msn.com>
+ *  copyright (c) 2001-2003 by Alastair M. Robinson <blackfive@fakenhamweb.co.uk>
+ *
+ *  licensed under GNU General Public License 2.0 or later
+ *  some rights reserved. see COPYING, AUTHORS
+ */
+
+/* fakelircd - stand-in for lircd which replays button sessions
+ *
+ * serves the lircd socket protocol, that is one line per decoded
+ * button, '<code> <repeat> <button> <remote>', to every connected
+ * client. sessions are plain text, one event per line:
+ *
+ *   <delay msecs> <button> [<repeats> [<interval msecs> [<remote>]]]
+ *   <delay msecs> <code> <repeat> <button> <remote>
+ *
+ * the first form presses a button, optionally holding it for a number
+ * of repeat codes. the second is a verbatim lircd line, as written by
+ * record mode ('-R'), which taps a real lircd socket and timestamps
+ * everything it sends */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#define FAKELIRCD_MAXCLIENTS 16
+#define FAKELIRCD_MAXLINE 256
+#define FAKELIRCD_DEFAULTSOCKET "/var/run/lirc/lircd"
+
+static int clients[FAKELIRCD_MAXCLIENTS];
+static int clientcount = 0;
+static int listenfd = -1;
+static long linessent = 0;
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec * 1e3 + ts.tv_nsec / 1e6);
+}
+
+/* take on any clients waiting to connect, blocking for the first one
+ * if 'wait' is set */
+static void accept_clients(int wait) {
+  struct pollfd pfd;
+  int fd;
+
+  pfd.fd = listenfd;
+  pfd.events = POLLIN;
+  while (poll(&pfd, 1, wait && clientcount == 0 ? -1 : 0) > 0) {
+    if ((fd = accept4(listenfd, NULL, NULL, SOCK_CLOEXEC)) == -1)
+      break;
+    if (clientcount == FAKELIRCD_MAXCLIENTS) {
+      close(fd);
+      continue;
+    }
+    clients[clientcount++] = fd;
+    fprintf(stderr, "fakelircd: client connected (%d)\n", clientcount);
+  }
+}
+
+static void send_line(const char *line) {
+  size_t len = strlen(line);
+  int i;
+
+  accept_clients(FALSE);
+  for (i = 0; i < clientcount; ++i) {
+    if (write(clients[i], line, len) != (ssize_t) len) {
+      fprintf(stderr, "fakelircd: client disconnected\n");
+      close(clients[i]);
+      clients[i--] = clients[--clientcount];
+    }
+  }
+  ++linessent;
+}
+
+/* stable, made up, scancode for a button name */
+static unsigned long long button_code(const char *button) {
+  unsigned long long code = 1469598103934665603ULL;
+  for (; *button; ++button)
+    code = (code ^ (unsigned char) *button) * 1099511628211ULL;
+  return(code);
+}
+
+/* sleep until 'due', scaled by the replay rate. a rate of 0 sends
+ * everything as fast as the clients will take it */
+static void wait_until(double start, double due, double rate) {
+  struct timespec ts;
+  double delay;
+  if (rate <= 0)
+    return;
+  delay = start + due / rate - now();
+  if (delay > 0) {
+    ts.tv_sec = (time_t) (delay / 1e3);
+    ts.tv_nsec = (long) ((delay - ts.tv_sec * 1e3) * 1e6);
+    nanosleep(&ts, NULL);
+  }
+}
+
+static int replay(FILE *f, double rate) {
+  char buf[FAKELIRCD_MAXLINE + 1], line[4 * (FAKELIRCD_MAXLINE + 1) + 32];
+  char field[4][FAKELIRCD_MAXLINE + 1];
+  double start = now(), due = 0, delay, interval;
+  int fields, repeats, r, lineno = 0;
+
+  while (fgets(buf, sizeof(buf), f)) {
+    ++lineno;
+    if (buf[0] == '#' || buf[0] == '\n')
+      continue;
+    fields = sscanf(buf, "%lf %256s %256s %256s %256s",
+                    &delay, field[0], field[1], field[2], field[3]);
+    if (fields < 2) {
+      fprintf(stderr, "fakelircd: cannot parse session line %d\n", lineno);
+      return(FALSE);
+    }
+    due += delay;
+    if (fields == 5 && strlen(field[0]) == 16 &&
+        strspn(field[0], "0123456789abcdefABCDEF") == 16) {
+      /* recorded lircd line */
+      wait_until(start, due, rate);
+      snprintf(line, sizeof(line), "%s %s %s %s\n", field[0], field[1], field[2], field[3]);
+      send_line(line);
+      continue;
+    }
+    repeats = fields > 2 ? atoi(field[1]) : 0;
+    interval = fields > 3 ? atof(field[2]) : 110;
+    for (r = 0; r <= repeats; ++r) {
+      if (r > 0)
+        due += interval;
+      wait_until(start, due, rate);
+      snprintf(line, sizeof(line), "%016llx %02x %s %s\n", button_code(field[0]),
+               r & 0xff, field[0], fields > 4 ? field[3] : "fakelircd");
+      send_line(line);
+    }
+  }
+  return(TRUE);
+}
+
+/* tap a real lircd and write a session file of what it sends */
+static int record(const char *socketpath, FILE *out) {
+  struct sockaddr_un addr;
+  char buf[FAKELIRCD_MAXLINE + 1];
+  double last = -1, t;
+  FILE *in;
+  int fd;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socketpath, sizeof(addr.sun_path) - 1);
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+      connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+    fprintf(stderr, "fakelircd: cannot connect to '%s': %s\n", socketpath, strerror(errno));
+    return(FALSE);
+  }
+  if (!(in = fdopen(fd, "r"))) {
+    close(fd);
+    return(FALSE);
+  }
+  fprintf(out, "# recorded from '%s'\n", socketpath);
+  while (fgets(buf, sizeof(buf), in)) {
+    t = now();
+    fprintf(out, "%.1f %s", last < 0 ? 0 : t - last, buf);
+    fflush(out);
+    last = t;
+  }
+  fclose(in);
+  return(TRUE);
+}
+
+static void usage(const char *progname) {
+  printf("usage: %s [options] session\n", progname);
+  printf("       %s -R [options] output\n", progname);
+  printf("  -h    --help\t\tdisplay this message\n");
+  printf("  -s    --socket\tlircd socket to serve, or tap when recording\n"
+         "                \t(default: " FAKELIRCD_DEFAULTSOCKET ")\n");
+  printf("  -r    --rate\t\treplay speed multiplier, 0 for no delays (default: 1)\n");
+  printf("  -l    --loops\t\ttimes to replay the session, 0 for ever (default: 1)\n");
+  printf("  -n    --nowait\tstart replaying without waiting for a client\n");
+  printf("  -R    --record\trecord a session from a running lircd\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *socketpath = FAKELIRCD_DEFAULTSOCKET;
+  struct sockaddr_un addr;
+  double rate = 1, start, elapsed;
+  int loops = 1, loop, wait = TRUE, recording = FALSE, result = TRUE;
+  FILE *f;
+
+  while (1) {
+    int c;
+    static struct option long_options[] = {
+      {"help", no_argument, NULL, 'h'},
+      {"socket", required_argument, NULL, 's'},
+      {"rate", required_argument, NULL, 'r'},
+      {"loops", required_argument, NULL, 'l'},
+      {"nowait", no_argument, NULL, 'n'},
+      {"record", no_argument, NULL, 'R'},
+      {0, 0, 0, 0}
+    };
+    c = getopt_long(argc, argv, "hs:r:l:nR", long_options, NULL);
+    if (c == -1)
+      break;
+    switch (c) {
+      case 'h':
+        usage(argv[0]);
+        return(EXIT_SUCCESS);
+      case 's':
+        socketpath = optarg;
+        break;
+      case 'r':
+        rate = atof(optarg);
+        break;
+      case 'l':
+        loops = atoi(optarg);
+        break;
+      case 'n':
+        wait = FALSE;
+        break;
+      case 'R':
+        recording = TRUE;
+        break;
+      default:
+        usage(argv[0]);
+        return(EXIT_FAILURE);
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return(EXIT_FAILURE);
+  }
+
+  if (recording) {
+    if (!(f = fopen(argv[optind], "w"))) {
+      fprintf(stderr, "fakelircd: cannot write '%s'\n", argv[optind]);
+      return(EXIT_FAILURE);
+    }
+    result = record(socketpath, f);
+    fclose(f);
+    return(result ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  if (!(f = fopen(argv[optind], "r"))) {
+    fprintf(stderr, "fakelircd: cannot read '%s'\n", argv[optind]);
+    return(EXIT_FAILURE);
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socketpath) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "fakelircd: socket path too long\n");
+    return(EXIT_FAILURE);
+  }
+  strcpy(addr.sun_path, socketpath);
+  unlink(socketpath);
+  if ((listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1 ||
+      bind(listenfd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+      listen(listenfd, FAKELIRCD_MAXCLIENTS) == -1) {
+    fprintf(stderr, "fakelircd: cannot serve '%s': %s\n", socketpath, strerror(errno));
+    return(EXIT_FAILURE);
+  }
+
+  if (wait)
+    fprintf(stderr, "fakelircd: waiting for a client on '%s'\n", socketpath);
+  accept_clients(wait);
+
+  start = now();
+  for (loop = 0; result && (loops == 0 || loop < loops); ++loop) {
+    rewind(f);
+    result = replay(f, rate);
+  }
+  elapsed = now() - start;
+  fprintf(stderr, "fakelircd: sent %ld lines in %.1f ms (%.0f lines/s)\n",
+          linessent, elapsed, elapsed > 0 ? linessent * 1e3 / elapsed : 0.0);
+
+  fclose(f);
+  while (clientcount > 0)
+    close(clients[--clientcount]);
+  close(listenfd);
+  unlink(socketpath);
+
+  return(result ? EXIT_SUCCESS : EXIT_FAILURE);
+}